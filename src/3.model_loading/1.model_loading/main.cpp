@@ -7,6 +7,22 @@
 #include <filesystem>
 #include <cmath>
 #include <optional>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include <fmt/core.h>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
@@ -14,10 +30,12 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <assimp/Importer.hpp>
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
@@ -44,6 +62,25 @@ struct Vertex
   glm::vec2 textureCoordinate;
 };
 
+// the optional compact format, 16 bytes instead of 32: the position as 16 bit unorm within the mesh bounds (the fourth
+// value only pads), the normal octahedral encoded into two 16 bit snorm and the texture coordinate as two half floats
+struct CompactVertex
+{
+  uint16_t position[4];
+  int16_t normal[2];
+  uint16_t textureCoordinate[2];
+};
+
+// the largest difference between a mesh's vertices and what the shaders decode from its compact vertices
+struct CompactMeshReport
+{
+  float positionError; // in model units
+  float normalError; // in degrees
+  float textureCoordinateError;
+  size_t fullBytes;
+  size_t compactBytes;
+};
+
 struct Texture
 {
   unsigned int id;
@@ -51,11 +88,50 @@ struct Texture
   std::filesystem::path filename;
 };
 
+// no single upload of mesh data or texture rows is larger than this, so a huge mesh or texture is spread over several
+// frames
+const size_t MODEL_UPLOAD_CHUNK_BYTES = 4 << 20;
+
+// a decoded image waiting for its upload, data is freed once it is on the GPU
+struct TextureImage
+{
+  unsigned char* data;
+  int width;
+  int height;
+  int nrComponents;
+};
+
+// the sampler uniform a texture of the material is read through and the unit it is bound to, worked out once when the
+// material is built; location is looked up the first time the material is drawn with a program
+struct MaterialBinding
+{
+  unsigned int unit;
+  unsigned int texture;
+  std::string uniform;
+  int location;
+};
+
+// one per assimp material, every mesh using it shares it
+struct Material
+{
+  std::vector<unsigned int> textures; // indices into the model's textures
+  std::vector<MaterialBinding> bindings;
+  unsigned int program; // the program the binding locations were looked up in
+};
+
+// vertices and indices are only filled for meshes imported through assimp and are released once the mesh is uploaded, a
+// mesh read from the cache is uploaded straight from the mapping and keeps just the counts
 struct Mesh
 {
   std::vector<Vertex> vertices;
   std::vector<unsigned int> indices;
-  std::vector<Texture> textures;
+  unsigned int material;
+  unsigned int vertexCount;
+  unsigned int indexCount;
+  glm::vec3 minimum;
+  glm::vec3 maximum;
+  bool compact; // CompactVertex instead of Vertex, the shaders then need COMPACT_VERTICES
+  GLenum indexType; // GL_UNSIGNED_SHORT for compact meshes whose indices fit
   unsigned int vbo;
   unsigned int vao;
   unsigned int ebo;
@@ -64,13 +140,127 @@ struct Mesh
 struct Model
 {
   std::vector<Mesh> meshes;
+  std::vector<Material> materials;
+  std::vector<Texture> textures;
+};
+
+// read only view of a whole file, the mapping is released together with the last reference to it
+struct MappedFile
+{
+  const uint8_t* data;
+  size_t size;
+};
+
+const char MODEL_CACHE_MAGIC[4] = { 'M', 'D', 'L', 'C' };
+const uint32_t MODEL_CACHE_VERSION = 2;
+// what the cache is keyed on besides the source, changing them imports the model again
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs;
+const std::string MODEL_TEXTURE_TYPES[4] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+
+// a cache is the header, the dependency, texture, material, material texture and mesh tables and then the blobs they
+// point into, offsets are from the start of the file; vertex blobs are Vertex arrays and index blobs 32 bit indices, both
+// as they go to glBufferData; dependency and texture paths are relative to the model's directory
+struct ModelCacheHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t sourceHash; // over the source and then every dependency, in table order
+  uint32_t importFlags;
+  uint32_t dependencyCount;
+  uint32_t textureCount;
+  uint32_t materialCount;
+  uint32_t materialTextureCount;
+  uint32_t meshCount;
+};
+
+// a file other than the source the import read, like the .mtl of an .obj
+struct ModelCacheDependency
+{
+  uint64_t pathOffset;
+  uint32_t pathSize;
+  uint32_t padding;
+};
+
+struct ModelCacheTexture
+{
+  uint64_t pathOffset;
+  uint32_t pathSize;
+  uint32_t type; // index into MODEL_TEXTURE_TYPES
+};
+
+struct ModelCacheMaterial
+{
+  uint32_t firstTexture; // into the material texture table
+  uint32_t textureCount;
+};
+
+struct ModelCacheMesh
+{
+  uint64_t vertexOffset;
+  uint64_t indexOffset;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  uint32_t material;
+  float minimum[3];
+  float maximum[3];
+  uint32_t padding;
 };
 
 struct ModelContext
 {
   std::filesystem::path filename;
   std::filesystem::path directory;
+  std::vector<std::filesystem::path> dependencies; // files besides the source the import read, the cache is keyed on them too
   std::vector<Texture> textures;
+  std::unordered_map<std::string, unsigned int> textureIndices; // keyed by texture type and resolved path
+  std::vector<Material> materials;
+  std::unordered_map<unsigned int, unsigned int> materialIndices; // keyed by the assimp material index
+  unsigned int threads; // threads decoding textures, the GL context stays on the calling thread
+  bool compactVertices;
+};
+
+// where a mesh is uploaded from, the imported vectors or the cache mapping
+struct MeshSource
+{
+  const uint8_t* vertices;
+  const uint8_t* indices;
+};
+
+enum ModelLoadStatus
+{
+  MODEL_LOAD_LOADING,
+  MODEL_LOAD_READY,
+  MODEL_LOAD_FAILED,
+};
+
+// a model loading in the background: a thread reads the cache or imports the model and then decodes the textures on the
+// worker pool, while the GL thread uploads what is ready a little every frame; everything below model is only touched
+// by the GL thread once parsed is set, apart from images and decoded which fill up while decoding runs
+struct ModelLoad
+{
+  ModelContext context;
+  Model model;
+  ModelLoadStatus status;
+  std::atomic<bool> parsed;
+  std::atomic<bool> failed;
+  std::atomic<bool> cancelled;
+  bool cached;
+  std::shared_ptr<const MappedFile> cache;
+  std::vector<Mesh> meshes;
+  std::vector<MeshSource> sources;
+  std::vector<std::vector<uint8_t>> packed; // compact vertices and then indices per mesh, when the context asks for them
+  std::vector<TextureImage> images;
+  std::vector<unsigned int> decoded; // texture indices in the order they finished decoding, guarded by mutex
+  std::mutex mutex;
+  unsigned int uploadedMeshes;
+  size_t uploadedBytes; // of the mesh being uploaded, its vertices and then its indices
+  unsigned int uploadedTextures;
+  int uploadedRows; // of the texture being uploaded, its mipmaps are generated once all are up
+  unsigned int uploadFrames;
+  double uploadSeconds;
+  std::chrono::steady_clock::time_point start;
+  // last, so it is destroyed first and waits for the thread before anything it uses goes
+  std::future<void> work;
 };
 
 std::string readFile(std::filesystem::path& path)
@@ -93,6 +283,14 @@ std::string readFile(std::filesystem::path& path)
   return content;
 }
 
+// the define goes right after the #version line, which has to stay first
+std::string addShaderDefine(std::string source, std::string define)
+{
+  size_t lineEnd = source.find('\n');
+  size_t position = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+  return source.insert(position, "#define " + define + "\n");
+}
+
 unsigned char* readImage(std::filesystem::path& path, int& width, int& height, int& nrChannels)
 {
   return stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
@@ -144,112 +342,158 @@ GLenum textureFormatFromChannel(int nrChannels)
   return format;
 }
 
-void setupMesh(Mesh& mesh)
+size_t meshVertexSize(Mesh& mesh)
+{
+  return mesh.compact ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+size_t meshIndexSize(Mesh& mesh)
+{
+  return mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
+// the buffers are allocated empty, the data follows in chunks
+void createMeshBuffers(Mesh& mesh)
 {
   glGenVertexArrays(1, &mesh.vao);
   glGenBuffers(1, &mesh.vbo);
   glGenBuffers(1, &mesh.ebo);
   glBindVertexArray(mesh.vao);
   glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-  glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), &mesh.vertices[0], GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, position)));
+  glBufferData(GL_ARRAY_BUFFER, mesh.vertexCount * meshVertexSize(mesh), NULL, GL_STATIC_DRAW);
+  if (mesh.compact)
+  {
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)(offsetof(CompactVertex, position)));
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)(offsetof(CompactVertex, normal)));
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)(offsetof(CompactVertex, textureCoordinate)));
+  }
+  else
+  {
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, position)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, normal)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, textureCoordinate)));
+  }
   glEnableVertexAttribArray(0);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, normal)));
   glEnableVertexAttribArray(1);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, textureCoordinate)));
   glEnableVertexAttribArray(2);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), &mesh.indices[0], GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount * meshIndexSize(mesh), NULL, GL_STATIC_DRAW);
   glBindVertexArray(0);
 }
 
-void drawMesh(Mesh& mesh, unsigned int shaderProgram)
+// binds only the material's own textures, the sampler uniforms are set again as the material may share a name with
+// another material that put it on a different unit
+void useMaterial(Material& material, unsigned int shaderProgram)
 {
-  unsigned int diffuseNr = 1;
-  unsigned int specularNr = 1;
-  unsigned int normalNr = 1;
-  unsigned int heightNr = 1;
-  for (unsigned int i = 0; i < mesh.textures.size(); i++)
+  if (material.program != shaderProgram)
   {
-    Texture texture = mesh.textures[i];
-    glActiveTexture(GL_TEXTURE0 + i);
-    std::string number;
-    std::string name = texture.type;
-    if (name == "texture_diffuse")
-      number = std::to_string(diffuseNr++);
-    else if (name == "texture_specular")
-      number = std::to_string(specularNr++);
-    else if (name == "texture_normal")
-      number = std::to_string(normalNr++);
-    else if (name == "texture_height")
-      number = std::to_string(heightNr++);
-    std::string location = name + number;
-    glUniform1i(glGetUniformLocation(shaderProgram, &location[0]), i);
-    glBindTexture(GL_TEXTURE_2D, texture.id);
+    for (MaterialBinding& binding : material.bindings)
+    {
+      binding.location = glGetUniformLocation(shaderProgram, binding.uniform.c_str());
+    }
+    material.program = shaderProgram;
+  }
+  for (MaterialBinding& binding : material.bindings)
+  {
+    glUniform1i(binding.location, binding.unit);
+    glActiveTexture(GL_TEXTURE0 + binding.unit);
+    glBindTexture(GL_TEXTURE_2D, binding.texture);
   }
   glActiveTexture(GL_TEXTURE0);
-  glBindVertexArray(mesh.vao);
-  glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
 }
 
-unsigned int readTexture(std::filesystem::path& filename, bool gamma)
+void drawMesh(Mesh& mesh, unsigned int shaderProgram)
 {
-  unsigned int textureId;
-  glGenTextures(1, &textureId);
-  int width, height, nrComponents;
-  stbi_set_flip_vertically_on_load(true);
-  unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-  if (data)
+  if (mesh.compact)
   {
-    GLenum format = textureFormatFromChannel(nrComponents);
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    stbi_image_free(data);
+    glUniform3fv(glGetUniformLocation(shaderProgram, "positionOffset"), 1, glm::value_ptr(mesh.minimum));
+    glUniform3fv(glGetUniformLocation(shaderProgram, "positionScale"), 1, glm::value_ptr(mesh.maximum - mesh.minimum));
   }
-  else
+  glBindVertexArray(mesh.vao);
+  glDrawElements(GL_TRIANGLES, mesh.indexCount, mesh.indexType, 0);
+  glBindVertexArray(0);
+}
+
+// safe to call from any thread, the flip flag is set for the calling thread only
+TextureImage decodeTexture(std::filesystem::path& filename)
+{
+  TextureImage image = {};
+  stbi_set_flip_vertically_on_load_thread(true);
+  image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.nrComponents, 0);
+  stbi_set_flip_vertically_on_load_thread(false);
+  if (!image.data)
   {
     std::cout << "Texture failed to load at path: " << filename << std::endl;
-    stbi_image_free(data);
   }
-  stbi_set_flip_vertically_on_load(false);
-  return textureId;
+  return image;
 }
 
-std::vector<Texture> readMaterialTextures(aiMaterial* material, aiTextureType textureType, std::string textureTypeName, ModelContext& context)
+void collectMaterialTextures(aiMaterial* aiMaterial, aiTextureType textureType, std::string textureTypeName, ModelContext& context, Material& material)
 {
-  std::vector<Texture> textures;
-  for (unsigned int i = 0; i < material->GetTextureCount(textureType); i++)
+  for (unsigned int i = 0; i < aiMaterial->GetTextureCount(textureType); i++)
   {
     aiString path;
-    material->GetTexture(textureType, i, &path);
+    aiMaterial->GetTexture(textureType, i, &path);
     std::filesystem::path filename = context.directory / (std::filesystem::path)path.C_Str();
-    bool skip = false;
-    for (Texture& texture : context.textures)
+    std::string key = textureTypeName + ":" + filename.string();
+    auto found = context.textureIndices.find(key);
+    if (found == context.textureIndices.end())
     {
-      if(texture.filename == filename)
-      {
-        textures.push_back(texture);
-        skip = true;
-        break;
-      }
+      found = context.textureIndices.emplace(key, (unsigned int)context.textures.size()).first;
+      context.textures.push_back(Texture { .id = 0, .type = textureTypeName, .filename = filename });
     }
-    if (!skip)
+    material.textures.push_back(found->second);
+  }
+}
+
+// walks the nodes in the order meshesFromAiNode does and builds each material the first time a mesh uses it, its
+// textures are only registered here, they are decoded once every material is known
+void collectNodeMaterials(aiNode *node, const aiScene *scene, ModelContext& context)
+{
+  for (unsigned int i = 0; i < node->mNumMeshes; i++)
+  {
+    unsigned int materialIndex = scene->mMeshes[node->mMeshes[i]]->mMaterialIndex;
+    if (context.materialIndices.contains(materialIndex))
     {
-      Texture texture;
-      texture.id = readTexture(filename, false);
-      texture.type = textureTypeName;
-      texture.filename = filename;
-      textures.push_back(texture);
-      context.textures.push_back(texture);
+      continue;
     }
+    aiMaterial* aiMaterial = scene->mMaterials[materialIndex];
+    Material material = Material { .textures = {}, .bindings = {}, .program = 0 };
+    collectMaterialTextures(aiMaterial, aiTextureType_DIFFUSE, "texture_diffuse", context, material);
+    collectMaterialTextures(aiMaterial, aiTextureType_SPECULAR, "texture_specular", context, material);
+    collectMaterialTextures(aiMaterial, aiTextureType_HEIGHT, "texture_normal", context, material);
+    collectMaterialTextures(aiMaterial, aiTextureType_AMBIENT, "texture_height", context, material);
+    context.materialIndices.emplace(materialIndex, (unsigned int)context.materials.size());
+    context.materials.push_back(material);
+  }
+  for (unsigned int i = 0; i < node->mNumChildren; i++)
+  {
+    collectNodeMaterials(node->mChildren[i], scene, context);
+  }
+}
+
+// units follow the texture order, diffuse maps first, and each type is numbered from 1 as the shaders expect
+void setupMaterial(Material& material, std::vector<Texture>& textures)
+{
+  unsigned int diffuseNr = 1;
+  unsigned int specularNr = 1;
+  unsigned int normalNr = 1;
+  unsigned int heightNr = 1;
+  for (unsigned int i = 0; i < material.textures.size(); i++)
+  {
+    Texture& texture = textures[material.textures[i]];
+    std::string number;
+    std::string name = texture.type;
+    if (name == "texture_diffuse")
+      number = std::to_string(diffuseNr++);
+    else if (name == "texture_specular")
+      number = std::to_string(specularNr++);
+    else if (name == "texture_normal")
+      number = std::to_string(normalNr++);
+    else if (name == "texture_height")
+      number = std::to_string(heightNr++);
+    material.bindings.push_back(MaterialBinding { .unit = i, .texture = texture.id, .uniform = name + number, .location = -1 });
   }
-  return textures;
 }
 
 Mesh meshFromAiMesh(aiMesh *aiMesh, const aiScene *scene, ModelContext& context)
@@ -257,7 +501,13 @@ Mesh meshFromAiMesh(aiMesh *aiMesh, const aiScene *scene, ModelContext& context)
   Mesh mesh = Mesh
     { .vertices = {},
       .indices = {},
-      .textures = {},
+      .material = context.materialIndices.at(aiMesh->mMaterialIndex),
+      .vertexCount = aiMesh->mNumVertices,
+      .indexCount = 0,
+      .minimum = glm::vec3(INFINITY),
+      .maximum = glm::vec3(-INFINITY),
+      .compact = false,
+      .indexType = GL_UNSIGNED_INT
     };
   for (unsigned int i = 0; i < aiMesh->mNumVertices; i++)
   {
@@ -277,6 +527,8 @@ Mesh meshFromAiMesh(aiMesh *aiMesh, const aiScene *scene, ModelContext& context)
     textureCoordinate.y = aiMesh->mTextureCoords[0][i].y;
     vertex.textureCoordinate = textureCoordinate;
     mesh.vertices.push_back(vertex);
+    mesh.minimum = glm::min(mesh.minimum, position);
+    mesh.maximum = glm::max(mesh.maximum, position);
   }
   for (unsigned int i = 0; i < aiMesh->mNumFaces; i++)
   {
@@ -287,16 +539,7 @@ Mesh meshFromAiMesh(aiMesh *aiMesh, const aiScene *scene, ModelContext& context)
       mesh.indices.push_back(indice);
     }
   }
-  aiMaterial* material = scene->mMaterials[aiMesh->mMaterialIndex];
-  std::vector<Texture> diffuseMap = readMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", context);
-  context.textures.insert(context.textures.end(), diffuseMap.begin(), diffuseMap.end());
-  std::vector<Texture> specularMap = readMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", context);
-  context.textures.insert(context.textures.end(), specularMap.begin(), specularMap.end());
-  std::vector<Texture> normalMap = readMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", context);
-  context.textures.insert(context.textures.end(), normalMap.begin(), normalMap.end());
-  std::vector<Texture> heightMap = readMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", context);
-  context.textures.insert(context.textures.end(), heightMap.begin(), heightMap.end());
-  mesh.textures.insert(mesh.textures.end(), context.textures.begin(), context.textures.end());
+  mesh.indexCount = mesh.indices.size();
   return mesh;
 }
 
@@ -317,31 +560,755 @@ std::vector<Mesh> meshesFromAiNode(aiNode *node, const aiScene *scene, ModelCont
   return meshes;
 }
 
-Model readModel(ModelContext& context)
+// returns nothing when the file can not be opened or is empty
+std::shared_ptr<const MappedFile> mapFile(std::filesystem::path path)
+{
+#if defined(_WIN32)
+  // no mmap here, the file is read into memory in one go instead
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file || file.tellg() <= 0)
+  {
+    return nullptr;
+  }
+  size_t size = (size_t)file.tellg();
+  uint8_t* data = new uint8_t[size];
+  file.seekg(0);
+  file.read((char*)data, size);
+  return std::shared_ptr<const MappedFile>(new MappedFile { .data = data, .size = size }, [](const MappedFile* mappedFile)
+  {
+    delete[] mappedFile->data;
+    delete mappedFile;
+  });
+#else
+  int descriptor = open(path.c_str(), O_RDONLY);
+  if (descriptor < 0)
+  {
+    return nullptr;
+  }
+  struct stat status;
+  if (fstat(descriptor, &status) != 0 || status.st_size <= 0)
+  {
+    close(descriptor);
+    return nullptr;
+  }
+  size_t size = (size_t)status.st_size;
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  // the mapping keeps the file alive on its own
+  close(descriptor);
+  if (data == MAP_FAILED)
+  {
+    return nullptr;
+  }
+  return std::shared_ptr<const MappedFile>(new MappedFile { .data = (const uint8_t*)data, .size = size }, [](const MappedFile* mappedFile)
+  {
+    munmap((void*)mappedFile->data, mappedFile->size);
+    delete mappedFile;
+  });
+#endif
+}
+
+// fnv-1a over the file's size and then its contents eight bytes at a time, the tail a byte at a time, carried on from
+// hash; a file that can not be read or is empty only adds a size of 0, so removing a dependency changes the hash too
+uint64_t hashModelFile(std::filesystem::path& path, uint64_t hash)
+{
+  std::shared_ptr<const MappedFile> file = mapFile(path);
+  hash = (hash ^ (file == nullptr ? 0 : file->size)) * 1099511628211ull;
+  if (file == nullptr)
+  {
+    return hash;
+  }
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= file->size; i += sizeof(uint64_t))
+  {
+    uint64_t word;
+    std::memcpy(&word, file->data + i, sizeof(uint64_t));
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  for (; i < file->size; i++)
+  {
+    hash = (hash ^ file->data[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t hashModelSources(std::filesystem::path& source, std::vector<std::filesystem::path>& dependencies)
+{
+  uint64_t hash = hashModelFile(source, 14695981039346656037ull);
+  for (std::filesystem::path& dependency : dependencies)
+  {
+    hash = hashModelFile(dependency, hash);
+  }
+  return hash;
+}
+
+bool modelCacheRangeFits(const MappedFile& file, uint64_t offset, uint64_t size)
+{
+  return offset <= file.size && size <= file.size - offset;
+}
+
+// fills the context's dependencies, textures and materials and the meshes, which are uploaded straight from the mapping;
+// a cache that is missing, out of date or not valid is treated as a miss and nothing is filled
+bool readModelCache(std::filesystem::path& path, ModelLoad& load)
+{
+  ModelContext& context = load.context;
+  std::shared_ptr<const MappedFile> file = mapFile(path);
+  ModelCacheHeader header;
+  if (file == nullptr || file->size < sizeof(ModelCacheHeader))
+  {
+    return false;
+  }
+  std::memcpy(&header, file->data, sizeof(ModelCacheHeader));
+  uint64_t dependenciesOffset = sizeof(ModelCacheHeader);
+  uint64_t texturesOffset = dependenciesOffset + (uint64_t)header.dependencyCount * sizeof(ModelCacheDependency);
+  uint64_t materialsOffset = texturesOffset + (uint64_t)header.textureCount * sizeof(ModelCacheTexture);
+  uint64_t materialTexturesOffset = materialsOffset + (uint64_t)header.materialCount * sizeof(ModelCacheMaterial);
+  uint64_t meshesOffset = materialTexturesOffset + (uint64_t)header.materialTextureCount * sizeof(uint32_t);
+  if (std::memcmp(header.magic, MODEL_CACHE_MAGIC, sizeof(MODEL_CACHE_MAGIC)) != 0
+    || header.version != MODEL_CACHE_VERSION
+    || header.importFlags != MODEL_IMPORT_FLAGS
+    || !modelCacheRangeFits(*file, meshesOffset, (uint64_t)header.meshCount * sizeof(ModelCacheMesh)))
+  {
+    return false;
+  }
+  std::vector<ModelCacheDependency> cacheDependencies(header.dependencyCount);
+  std::memcpy(cacheDependencies.data(), file->data + dependenciesOffset, cacheDependencies.size() * sizeof(ModelCacheDependency));
+  std::vector<std::filesystem::path> dependencies;
+  for (ModelCacheDependency& dependency : cacheDependencies)
+  {
+    if (!modelCacheRangeFits(*file, dependency.pathOffset, dependency.pathSize))
+    {
+      std::cout << "ERROR::MODEL_CACHE::INVALID_DEPENDENCY " << path << std::endl;
+      return false;
+    }
+    dependencies.push_back(context.directory / std::string((const char*)file->data + dependency.pathOffset, dependency.pathSize));
+  }
+  if (header.sourceHash != hashModelSources(context.filename, dependencies))
+  {
+    return false;
+  }
+  std::vector<ModelCacheTexture> textures(header.textureCount);
+  std::vector<ModelCacheMaterial> materials(header.materialCount);
+  std::vector<uint32_t> materialTextures(header.materialTextureCount);
+  std::vector<ModelCacheMesh> cacheMeshes(header.meshCount);
+  std::memcpy(textures.data(), file->data + texturesOffset, textures.size() * sizeof(ModelCacheTexture));
+  std::memcpy(materials.data(), file->data + materialsOffset, materials.size() * sizeof(ModelCacheMaterial));
+  std::memcpy(materialTextures.data(), file->data + materialTexturesOffset, materialTextures.size() * sizeof(uint32_t));
+  std::memcpy(cacheMeshes.data(), file->data + meshesOffset, cacheMeshes.size() * sizeof(ModelCacheMesh));
+  for (ModelCacheTexture& texture : textures)
+  {
+    if (!modelCacheRangeFits(*file, texture.pathOffset, texture.pathSize) || texture.type >= std::size(MODEL_TEXTURE_TYPES))
+    {
+      std::cout << "ERROR::MODEL_CACHE::INVALID_TEXTURE " << path << std::endl;
+      return false;
+    }
+  }
+  for (ModelCacheMaterial& material : materials)
+  {
+    bool valid = (uint64_t)material.firstTexture + material.textureCount <= materialTextures.size();
+    for (unsigned int i = 0; valid && i < material.textureCount; i++)
+    {
+      valid = materialTextures[material.firstTexture + i] < textures.size();
+    }
+    if (!valid)
+    {
+      std::cout << "ERROR::MODEL_CACHE::INVALID_MATERIAL " << path << std::endl;
+      return false;
+    }
+  }
+  for (ModelCacheMesh& mesh : cacheMeshes)
+  {
+    if (mesh.material >= materials.size()
+      || !modelCacheRangeFits(*file, mesh.vertexOffset, (uint64_t)mesh.vertexCount * sizeof(Vertex))
+      || !modelCacheRangeFits(*file, mesh.indexOffset, (uint64_t)mesh.indexCount * sizeof(unsigned int)))
+    {
+      std::cout << "ERROR::MODEL_CACHE::INVALID_MESH " << path << std::endl;
+      return false;
+    }
+  }
+  context.dependencies = dependencies;
+  for (ModelCacheTexture& texture : textures)
+  {
+    std::string relativePath((const char*)file->data + texture.pathOffset, texture.pathSize);
+    context.textures.push_back(Texture
+      { .id = 0,
+        .type = MODEL_TEXTURE_TYPES[texture.type],
+        .filename = context.directory / relativePath
+      });
+  }
+  for (ModelCacheMaterial& material : materials)
+  {
+    std::vector<unsigned int> materialTextureIndices(materialTextures.begin() + material.firstTexture,
+                                                     materialTextures.begin() + material.firstTexture + material.textureCount);
+    context.materials.push_back(Material { .textures = materialTextureIndices, .bindings = {}, .program = 0 });
+  }
+  for (ModelCacheMesh& cacheMesh : cacheMeshes)
+  {
+    Mesh mesh = Mesh
+      { .vertices = {},
+        .indices = {},
+        .material = cacheMesh.material,
+        .vertexCount = cacheMesh.vertexCount,
+        .indexCount = cacheMesh.indexCount,
+        .minimum = glm::vec3(cacheMesh.minimum[0], cacheMesh.minimum[1], cacheMesh.minimum[2]),
+        .maximum = glm::vec3(cacheMesh.maximum[0], cacheMesh.maximum[1], cacheMesh.maximum[2]),
+        .compact = false,
+        .indexType = GL_UNSIGNED_INT
+      };
+    load.meshes.push_back(mesh);
+    load.sources.push_back(MeshSource { .vertices = file->data + cacheMesh.vertexOffset, .indices = file->data + cacheMesh.indexOffset });
+  }
+  load.cache = file;
+  return true;
+}
+
+void padModelCache(std::ofstream& file, uint64_t& offset, uint64_t alignment)
+{
+  static const char zeros[16] = {};
+  uint64_t padding = (alignment - offset % alignment) % alignment;
+  file.write(zeros, padding);
+  offset += padding;
+}
+
+bool writeModelCache(std::filesystem::path& path, uint64_t sourceHash, ModelContext& context, std::vector<Mesh>& meshes)
 {
-  Model model = Model
-    { .meshes = {}
+  std::vector<ModelCacheDependency> dependencies;
+  std::vector<ModelCacheTexture> textures;
+  std::vector<ModelCacheMaterial> materials;
+  std::vector<uint32_t> materialTextures;
+  std::vector<ModelCacheMesh> cacheMeshes;
+  std::vector<std::string> paths;
+  for (Material& material : context.materials)
+  {
+    materials.push_back(ModelCacheMaterial { .firstTexture = (uint32_t)materialTextures.size(), .textureCount = (uint32_t)material.textures.size() });
+    materialTextures.insert(materialTextures.end(), material.textures.begin(), material.textures.end());
+  }
+  uint64_t offset = sizeof(ModelCacheHeader)
+    + context.dependencies.size() * sizeof(ModelCacheDependency)
+    + context.textures.size() * sizeof(ModelCacheTexture)
+    + materials.size() * sizeof(ModelCacheMaterial)
+    + materialTextures.size() * sizeof(uint32_t)
+    + meshes.size() * sizeof(ModelCacheMesh);
+  for (std::filesystem::path& dependency : context.dependencies)
+  {
+    paths.push_back(dependency.lexically_relative(context.directory).generic_string());
+    dependencies.push_back(ModelCacheDependency { .pathOffset = offset, .pathSize = (uint32_t)paths.back().size(), .padding = 0 });
+    offset += paths.back().size();
+  }
+  for (Texture& texture : context.textures)
+  {
+    paths.push_back(texture.filename.lexically_relative(context.directory).generic_string());
+    uint32_t type = std::find(std::begin(MODEL_TEXTURE_TYPES), std::end(MODEL_TEXTURE_TYPES), texture.type) - std::begin(MODEL_TEXTURE_TYPES);
+    textures.push_back(ModelCacheTexture { .pathOffset = offset, .pathSize = (uint32_t)paths.back().size(), .type = type });
+    offset += paths.back().size();
+  }
+  uint64_t blobsOffset = offset;
+  for (Mesh& mesh : meshes)
+  {
+    offset += (16 - offset % 16) % 16;
+    ModelCacheMesh cacheMesh =
+    { .vertexOffset = offset,
+      .indexOffset = offset + mesh.vertices.size() * sizeof(Vertex),
+      .vertexCount = (uint32_t)mesh.vertices.size(),
+      .indexCount = (uint32_t)mesh.indices.size(),
+      .material = mesh.material,
+      .minimum = { mesh.minimum.x, mesh.minimum.y, mesh.minimum.z },
+      .maximum = { mesh.maximum.x, mesh.maximum.y, mesh.maximum.z },
+      .padding = 0
     };
+    cacheMeshes.push_back(cacheMesh);
+    offset = cacheMesh.indexOffset + mesh.indices.size() * sizeof(unsigned int);
+  }
+  ModelCacheHeader header =
+  { .magic = { MODEL_CACHE_MAGIC[0], MODEL_CACHE_MAGIC[1], MODEL_CACHE_MAGIC[2], MODEL_CACHE_MAGIC[3] },
+    .version = MODEL_CACHE_VERSION,
+    .sourceHash = sourceHash,
+    .importFlags = MODEL_IMPORT_FLAGS,
+    .dependencyCount = (uint32_t)dependencies.size(),
+    .textureCount = (uint32_t)textures.size(),
+    .materialCount = (uint32_t)materials.size(),
+    .materialTextureCount = (uint32_t)materialTextures.size(),
+    .meshCount = (uint32_t)cacheMeshes.size()
+  };
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char*)&header, sizeof(ModelCacheHeader));
+  file.write((const char*)dependencies.data(), dependencies.size() * sizeof(ModelCacheDependency));
+  file.write((const char*)textures.data(), textures.size() * sizeof(ModelCacheTexture));
+  file.write((const char*)materials.data(), materials.size() * sizeof(ModelCacheMaterial));
+  file.write((const char*)materialTextures.data(), materialTextures.size() * sizeof(uint32_t));
+  file.write((const char*)cacheMeshes.data(), cacheMeshes.size() * sizeof(ModelCacheMesh));
+  for (std::string& tablePath : paths)
+  {
+    file.write(tablePath.data(), tablePath.size());
+  }
+  offset = blobsOffset;
+  for (Mesh& mesh : meshes)
+  {
+    padModelCache(file, offset, 16);
+    file.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+    file.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+    offset += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+  }
+  return file.good();
+}
+
+// hands every file on to the default file system and keeps the path of each one the importer opens, the importer owns it
+struct RecordingIOSystem : Assimp::DefaultIOSystem
+{
+  std::vector<std::filesystem::path> paths;
+
+  Assimp::IOStream* Open(const char* file, const char* mode = "rb") override
+  {
+    paths.push_back(std::filesystem::path(file).lexically_normal());
+    return Assimp::DefaultIOSystem::Open(file, mode);
+  }
+};
+
+// the context's dependencies are every file the importer opened besides the source, each once in the order it was opened
+bool importModel(ModelContext& context, std::vector<Mesh>& meshes)
+{
   Assimp::Importer importer;
-  const aiScene *scene = importer.ReadFile(context.filename.c_str(), aiProcess_Triangulate | aiProcess_FlipUVs);
+  RecordingIOSystem* ioSystem = new RecordingIOSystem();
+  importer.SetIOHandler(ioSystem);
+  const aiScene *scene = importer.ReadFile(context.filename.c_str(), MODEL_IMPORT_FLAGS);
+  std::filesystem::path source = context.filename.lexically_normal();
+  for (std::filesystem::path& path : ioSystem->paths)
+  {
+    if (path != source && std::find(context.dependencies.begin(), context.dependencies.end(), path) == context.dependencies.end())
+    {
+      context.dependencies.push_back(path);
+    }
+  }
   if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
   {
     std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
-    return model;
+    return false;
   }
-  std::vector<Mesh> meshes = meshesFromAiNode(scene->mRootNode, scene, context);
-  for (Mesh& mesh : meshes)
+  // every material and texture the scene uses is known before any is decoded, the meshes then only refer to them
+  collectNodeMaterials(scene->mRootNode, scene, context);
+  meshes = meshesFromAiNode(scene->mRootNode, scene, context);
+  return true;
+}
+
+float signNotZero(float value)
+{
+  return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// the normal projected onto the octahedron and the lower half folded over the upper, both coordinates in [-1, 1]
+glm::vec2 encodeOctahedral(glm::vec3 normal)
+{
+  float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (length == 0.0f)
+  {
+    return glm::vec2(0.0f, 0.0f);
+  }
+  normal /= length;
+  if (normal.z >= 0.0f)
+  {
+    return glm::vec2(normal.x, normal.y);
+  }
+  return glm::vec2((1.0f - std::abs(normal.y)) * signNotZero(normal.x), (1.0f - std::abs(normal.x)) * signNotZero(normal.y));
+}
+
+// the same as decodeNormal in texture.vert
+glm::vec3 decodeOctahedral(glm::vec2 encoded)
+{
+  glm::vec3 normal = glm::vec3(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+  if (normal.z < 0.0f)
+  {
+    normal = glm::vec3((1.0f - std::abs(normal.y)) * signNotZero(normal.x), (1.0f - std::abs(normal.x)) * signNotZero(normal.y), normal.z);
+  }
+  return glm::normalize(normal);
+}
+
+uint16_t quantizeUnorm16(float value)
+{
+  return (uint16_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+int16_t quantizeSnorm16(float value)
+{
+  return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+// compact vertices followed by the indices, 16 bit when every index fits; the report compares each vertex with what
+// decoding its compact form gives back
+std::vector<uint8_t> packCompactMesh(Mesh& mesh, MeshSource& source, CompactMeshReport& report)
+{
+  glm::vec3 scale = mesh.maximum - mesh.minimum;
+  bool shortIndices = mesh.vertexCount <= UINT16_MAX + 1u;
+  size_t vertexBytes = mesh.vertexCount * sizeof(CompactVertex);
+  std::vector<uint8_t> packed(vertexBytes + mesh.indexCount * (shortIndices ? sizeof(uint16_t) : sizeof(unsigned int)));
+  report = CompactMeshReport
+  { .positionError = 0.0f,
+    .normalError = 0.0f,
+    .textureCoordinateError = 0.0f,
+    .fullBytes = mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * sizeof(unsigned int),
+    .compactBytes = packed.size()
+  };
+  for (unsigned int i = 0; i < mesh.vertexCount; i++)
+  {
+    Vertex vertex;
+    std::memcpy(&vertex, source.vertices + i * sizeof(Vertex), sizeof(Vertex));
+    CompactVertex compact = {};
+    glm::vec3 decodedPosition = mesh.minimum;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      float relative = scale[axis] > 0.0f ? (vertex.position[axis] - mesh.minimum[axis]) / scale[axis] : 0.0f;
+      compact.position[axis] = quantizeUnorm16(relative);
+      decodedPosition[axis] += compact.position[axis] / 65535.0f * scale[axis];
+    }
+    glm::vec2 octahedral = encodeOctahedral(vertex.normal);
+    compact.normal[0] = quantizeSnorm16(octahedral.x);
+    compact.normal[1] = quantizeSnorm16(octahedral.y);
+    glm::vec3 decodedNormal = decodeOctahedral(glm::vec2(compact.normal[0] / 32767.0f, compact.normal[1] / 32767.0f));
+    compact.textureCoordinate[0] = glm::packHalf1x16(vertex.textureCoordinate.x);
+    compact.textureCoordinate[1] = glm::packHalf1x16(vertex.textureCoordinate.y);
+    glm::vec2 decodedTextureCoordinate = glm::vec2(glm::unpackHalf1x16(compact.textureCoordinate[0]), glm::unpackHalf1x16(compact.textureCoordinate[1]));
+    std::memcpy(packed.data() + i * sizeof(CompactVertex), &compact, sizeof(CompactVertex));
+    report.positionError = std::max(report.positionError, glm::length(decodedPosition - vertex.position));
+    if (glm::length(vertex.normal) > 0.0f)
+    {
+      float cosine = std::clamp(glm::dot(glm::normalize(vertex.normal), decodedNormal), -1.0f, 1.0f);
+      report.normalError = std::max(report.normalError, glm::degrees(std::acos(cosine)));
+    }
+    glm::vec2 textureCoordinateDifference = glm::abs(decodedTextureCoordinate - vertex.textureCoordinate);
+    report.textureCoordinateError = std::max(report.textureCoordinateError, std::max(textureCoordinateDifference.x, textureCoordinateDifference.y));
+  }
+  for (unsigned int i = 0; i < mesh.indexCount; i++)
+  {
+    unsigned int index;
+    std::memcpy(&index, source.indices + i * sizeof(unsigned int), sizeof(unsigned int));
+    if (shortIndices)
+    {
+      uint16_t shortIndex = (uint16_t)index;
+      std::memcpy(packed.data() + vertexBytes + i * sizeof(uint16_t), &shortIndex, sizeof(uint16_t));
+    }
+    else
+    {
+      std::memcpy(packed.data() + vertexBytes + i * sizeof(unsigned int), &index, sizeof(unsigned int));
+    }
+  }
+  mesh.compact = true;
+  mesh.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  return packed;
+}
+
+// the meshes are uploaded from their packed copies instead of the imported vectors or the cache
+void packCompactMeshes(ModelLoad& load)
+{
+  load.packed.resize(load.meshes.size());
+  CompactMeshReport total = {};
+  for (unsigned int i = 0; i < load.meshes.size(); i++)
+  {
+    CompactMeshReport report;
+    load.packed[i] = packCompactMesh(load.meshes[i], load.sources[i], report);
+    load.sources[i] = MeshSource { .vertices = load.packed[i].data(), .indices = load.packed[i].data() + load.meshes[i].vertexCount * sizeof(CompactVertex) };
+    total.fullBytes += report.fullBytes;
+    total.compactBytes += report.compactBytes;
+    std::cout << "COMPACT_MESH:: " << i << ": " << load.meshes[i].vertexCount << " vertices, " << report.fullBytes << " -> "
+              << report.compactBytes << " bytes, position error " << report.positionError << ", normal error "
+              << report.normalError << " degrees, texture coordinate error " << report.textureCoordinateError << std::endl;
+  }
+  std::cout << "COMPACT_MESH:: " << total.fullBytes << " -> " << total.compactBytes << " bytes" << std::endl;
+}
+
+void decodeModelTextures(ModelLoad& load)
+{
+  std::vector<Texture>& textures = load.context.textures;
+  std::atomic<unsigned int> next = 0;
+  unsigned int threadCount = std::max(1u, std::min(load.context.threads, (unsigned int)textures.size()));
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < threadCount; t++)
+  {
+    workers.emplace_back([&]()
+    {
+      for (unsigned int i = next++; i < textures.size() && !load.cancelled; i = next++)
+      {
+        load.images[i] = decodeTexture(textures[i].filename);
+        std::lock_guard<std::mutex> lock(load.mutex);
+        load.decoded.push_back(i);
+      }
+    });
+  }
+  for (std::thread& worker : workers)
+  {
+    worker.join();
+  }
+}
+
+// the model is read from <source>.meshcache when that was written from the same source and dependencies with the same
+// import flags, otherwise it is imported and the cache written for the next run
+void runModelLoad(ModelLoad& load)
+{
+  std::filesystem::path cachePath = load.context.filename;
+  cachePath += ".meshcache";
+  load.cached = readModelCache(cachePath, load);
+  if (!load.cached)
+  {
+    if (!importModel(load.context, load.meshes))
+    {
+      load.failed = true;
+      return;
+    }
+    uint64_t sourceHash = hashModelSources(load.context.filename, load.context.dependencies);
+    if (!writeModelCache(cachePath, sourceHash, load.context, load.meshes))
+    {
+      std::cout << "ERROR::MODEL_CACHE::NOT_WRITTEN " << cachePath << std::endl;
+    }
+    for (Mesh& mesh : load.meshes)
+    {
+      load.sources.push_back(MeshSource { .vertices = (const uint8_t*)mesh.vertices.data(), .indices = (const uint8_t*)mesh.indices.data() });
+    }
+  }
+  if (load.context.compactVertices)
+  {
+    packCompactMeshes(load);
+  }
+  load.images.resize(load.context.textures.size());
+  load.parsed = true;
+  decodeModelTextures(load);
+}
+
+// returns at once, the model is usable when updateModelLoad has taken the load to MODEL_LOAD_READY
+std::shared_ptr<ModelLoad> startModelLoad(ModelContext context)
+{
+  std::shared_ptr<ModelLoad> load = std::make_shared<ModelLoad>();
+  load->context = context;
+  load->model = Model { .meshes = {}, .materials = {}, .textures = {} };
+  load->status = MODEL_LOAD_LOADING;
+  load->parsed = false;
+  load->failed = false;
+  load->cancelled = false;
+  load->cached = false;
+  load->uploadedMeshes = 0;
+  load->uploadedBytes = 0;
+  load->uploadedTextures = 0;
+  load->uploadedRows = 0;
+  load->uploadFrames = 0;
+  load->uploadSeconds = 0.0;
+  load->start = std::chrono::steady_clock::now();
+  // the load owns the thread and waits for it before it goes, so the thread can hold on to it by reference
+  ModelLoad* loading = load.get();
+  load->work = std::async(std::launch::async, [loading]() { runModelLoad(*loading); });
+  return load;
+}
+
+// sends up to MODEL_UPLOAD_CHUNK_BYTES of the mesh being uploaded, a chunk crossing the end of the vertices is split
+// over both buffers
+void uploadMeshChunk(ModelLoad& load)
+{
+  Mesh& mesh = load.meshes[load.uploadedMeshes];
+  MeshSource& source = load.sources[load.uploadedMeshes];
+  size_t vertexBytes = mesh.vertexCount * meshVertexSize(mesh);
+  size_t totalBytes = vertexBytes + mesh.indexCount * meshIndexSize(mesh);
+  if (load.uploadedBytes == 0)
+  {
+    createMeshBuffers(mesh);
+  }
+  size_t end = load.uploadedBytes + std::min(MODEL_UPLOAD_CHUNK_BYTES, totalBytes - load.uploadedBytes);
+  glBindVertexArray(mesh.vao);
+  if (load.uploadedBytes < vertexBytes)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, load.uploadedBytes, std::min(end, vertexBytes) - load.uploadedBytes, source.vertices + load.uploadedBytes);
+  }
+  if (end > vertexBytes)
+  {
+    size_t indexStart = std::max(load.uploadedBytes, vertexBytes) - vertexBytes;
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexStart, end - vertexBytes - indexStart, source.indices + indexStart);
+  }
+  glBindVertexArray(0);
+  if (end < totalBytes)
   {
-    setupMesh(mesh);
+    load.uploadedBytes = end;
+    return;
+  }
+  // the buffers hold the mesh now, the copies it was uploaded from are not needed again
+  mesh.vertices = std::vector<Vertex>();
+  mesh.indices = std::vector<unsigned int>();
+  if (mesh.compact)
+  {
+    load.packed[load.uploadedMeshes] = std::vector<uint8_t>();
+  }
+  source = MeshSource { .vertices = NULL, .indices = NULL };
+  load.uploadedBytes = 0;
+  load.uploadedMeshes++;
+}
+
+// the first chunk of a texture allocates its storage, then up to MODEL_UPLOAD_CHUNK_BYTES of rows go up per call and the
+// mipmaps are generated by a call of their own once every row is up; an image that failed to decode gets a texture
+// without storage in a single call
+void uploadTextureChunk(ModelLoad& load, unsigned int index)
+{
+  TextureImage& image = load.images[index];
+  Texture& texture = load.context.textures[index];
+  if (!image.data)
+  {
+    glGenTextures(1, &texture.id);
+    load.uploadedTextures++;
+    return;
+  }
+  GLenum format = textureFormatFromChannel(image.nrComponents);
+  if (load.uploadedRows == 0)
+  {
+    glGenTextures(1, &texture.id);
+  }
+  glBindTexture(GL_TEXTURE_2D, texture.id);
+  if (load.uploadedRows == 0)
+  {
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  }
+  if (load.uploadedRows < image.height)
+  {
+    size_t rowBytes = (size_t)image.width * image.nrComponents;
+    int rows = std::min(image.height - load.uploadedRows, (int)std::max<size_t>(1, MODEL_UPLOAD_CHUNK_BYTES / rowBytes));
+    // the decoded rows are tightly packed, whatever their width
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, load.uploadedRows, image.width, rows, format, GL_UNSIGNED_BYTE, image.data + load.uploadedRows * rowBytes);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    load.uploadedRows += rows;
+    return;
+  }
+  glGenerateMipmap(GL_TEXTURE_2D);
+  stbi_image_free(image.data);
+  image.data = NULL;
+  load.uploadedRows = 0;
+  load.uploadedTextures++;
+}
+
+void finishModelLoad(ModelLoad& load)
+{
+  load.work.get();
+  for (Material& material : load.context.materials)
+  {
+    setupMaterial(material, load.context.textures);
+  }
+  load.model.meshes = std::move(load.meshes);
+  load.model.materials = std::move(load.context.materials);
+  load.model.textures = std::move(load.context.textures);
+  load.cache = nullptr;
+  load.sources.clear();
+  load.packed.clear();
+  load.images.clear();
+  load.status = MODEL_LOAD_READY;
+  double milliseconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - load.start).count() * 1000.0;
+  std::cout << "MODEL:: " << load.model.meshes.size() << " meshes, " << load.model.materials.size() << " materials, "
+            << load.model.textures.size() << " textures" << (load.cached ? " from the cache" : " imported")
+            << ", textures decoded on " << load.context.threads << " threads" << std::endl;
+  std::cout << "MODEL:: loaded in " << milliseconds << "ms, uploads took " << load.uploadSeconds * 1000.0 << "ms over "
+            << load.uploadFrames << " frames" << std::endl;
+}
+
+// called once per frame on the GL thread, uploads meshes and then decoded textures a chunk at a time until budgetSeconds
+// are spent; one chunk always goes through so a budget smaller than a single chunk still makes progress
+void updateModelLoad(ModelLoad& load, double budgetSeconds)
+{
+  if (load.status != MODEL_LOAD_LOADING)
+  {
+    return;
+  }
+  if (load.failed)
+  {
+    load.work.get();
+    load.status = MODEL_LOAD_FAILED;
+    std::cout << "ERROR::MODEL::NOT_LOADED " << load.context.filename << std::endl;
+    return;
+  }
+  if (!load.parsed)
+  {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  bool uploaded = false;
+  while (!uploaded || std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < budgetSeconds)
+  {
+    if (load.uploadedMeshes < load.meshes.size())
+    {
+      uploadMeshChunk(load);
+    }
+    else
+    {
+      std::optional<unsigned int> next;
+      {
+        std::lock_guard<std::mutex> lock(load.mutex);
+        if (load.uploadedTextures < load.decoded.size())
+        {
+          next = load.decoded[load.uploadedTextures];
+        }
+      }
+      if (!next.has_value())
+      {
+        break;
+      }
+      uploadTextureChunk(load, next.value());
+    }
+    uploaded = true;
+  }
+  if (uploaded)
+  {
+    load.uploadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    load.uploadFrames++;
+  }
+  if (load.uploadedMeshes == load.meshes.size() && load.uploadedTextures == load.context.textures.size())
+  {
+    finishModelLoad(load);
+  }
+}
+
+// meshes count as much as textures, reading and importing the model counts as nothing; the loading thread is still
+// filling the meshes and textures until parsed is set, so they are not looked at before
+float modelLoadProgress(ModelLoad& load)
+{
+  if (load.status == MODEL_LOAD_READY)
+  {
+    return 1.0f;
+  }
+  if (!load.parsed)
+  {
+    return 0.0f;
+  }
+  size_t total = load.meshes.size() + load.context.textures.size();
+  if (total == 0)
+  {
+    return 0.0f;
+  }
+  return (load.uploadedMeshes + load.uploadedTextures) / (float)total;
+}
+
+// stops decoding what is left and waits for the loading thread, images decoded but never uploaded are freed
+void cancelModelLoad(ModelLoad& load)
+{
+  load.cancelled = true;
+  if (load.work.valid())
+  {
+    load.work.wait();
+  }
+  for (TextureImage& image : load.images)
+  {
+    if (image.data)
+    {
+      stbi_image_free(image.data);
+      image.data = NULL;
+    }
   }
-  model.meshes = meshes;
-  return model;
 }
 
 void drawModel(Model& model, unsigned int shaderProgram)
 {
+  // meshes sharing a material one after another bind its textures once
+  std::optional<unsigned int> boundMaterial;
   for (Mesh& mesh: model.meshes)
   {
+    if (boundMaterial != mesh.material)
+    {
+      useMaterial(model.materials[mesh.material], shaderProgram);
+      boundMaterial = mesh.material;
+    }
     drawMesh(mesh, shaderProgram);
   }
 }
@@ -409,7 +1376,7 @@ void handleScrollUpdate(GLFWwindow* window, double xoffset, double yoffset)
   state->fov = std::clamp(state->fov, 1.0f, 45.0f);
 }
 
-int main()
+int main(int argc, char** argv)
 {
   const GLuint width = 800, height = 600;
   ImVec4 clearColor = ImVec4(0.1f, 0.1f, 0.1f, 1.00f);
@@ -421,8 +1388,25 @@ int main()
   ModelContext modelContext = ModelContext
     { .filename = modelFilePath,
       .directory = modelDirectory,
-      .textures = {}
+      .dependencies = {},
+      .textures = {},
+      .threads = std::max(1u, std::thread::hardware_concurrency()),
+      .compactVertices = false
     };
+  // time each frame may spend uploading the model while it loads
+  double uploadBudgetSeconds = 0.004;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    std::string flag = argv[i];
+    if (flag == "--threads")
+      modelContext.threads = std::max(1, std::stoi(argv[i + 1]));
+    else if (flag == "--compact-vertices")
+      modelContext.compactVertices = std::stoi(argv[i + 1]) != 0;
+    else if (flag == "--upload-budget")
+      uploadBudgetSeconds = std::max(0.0, std::stod(argv[i + 1]) / 1000.0);
+    else
+      std::cout << "Unknown flag: " << flag << std::endl;
+  }
   State state = State
     { .cameraPosition = glm::vec3(0.0f, 0.0f, 3.0f),
       .cameraFront = glm::vec3(0.0f, 0.0f, -1.0f),
@@ -459,12 +1443,16 @@ int main()
   }
   std::cout << "Loaded OpenGL " << GLAD_VERSION_MAJOR(version) << "." << GLAD_VERSION_MINOR(version) << std::endl;
   std::string vertexShaderSource = readFile(vertexShaderFilePath);
+  if (modelContext.compactVertices)
+  {
+    vertexShaderSource = addShaderDefine(vertexShaderSource, "COMPACT_VERTICES");
+  }
   unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource.c_str());
   std::string fragmentShaderSource = readFile(fragmentShaderFilePath);
   unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource.c_str());
   std::vector<unsigned int> shaders = {vertexShader, fragmentShader};
   unsigned int shaderProgram = createShaderProgram(shaders);
-  Model object = readModel(modelContext);
+  std::shared_ptr<ModelLoad> modelLoad = startModelLoad(modelContext);
   ImGui::CreateContext();
   ImGuiIO& io = ImGui::GetIO(); (void)io;
   ImGui::StyleColorsDark();
@@ -484,11 +1472,16 @@ int main()
     state.lastFrame = time;
     handleInput(window, &state);
     glfwPollEvents();
+    updateModelLoad(*modelLoad, uploadBudgetSeconds);
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
     ImGui::Begin("Adjust clear color");
     ImGui::ColorEdit3("clear color", (float*)&clearColor); // Edit 3 floats representing a color
+    if (modelLoad->status == MODEL_LOAD_LOADING)
+    {
+      ImGui::ProgressBar(modelLoadProgress(*modelLoad));
+    }
     ImGui::End();
     ImGui::Render();
     glClearColor(clearColor.x * clearColor.w, clearColor.y * clearColor.w, clearColor.z * clearColor.w, clearColor.w);
@@ -513,10 +1506,14 @@ int main()
     glUniform1f(glGetUniformLocation(shaderProgram, "spotLight.constant"), 1.0f);
     glUniform1f(glGetUniformLocation(shaderProgram, "spotLight.linear"), 0.09f);
     glUniform1f(glGetUniformLocation(shaderProgram, "spotLight.quadratic"), 0.032f);
-    drawModel(object, shaderProgram);
+    if (modelLoad->status == MODEL_LOAD_READY)
+    {
+      drawModel(modelLoad->model, shaderProgram);
+    }
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     glfwSwapBuffers(window);
   }
+  cancelModelLoad(*modelLoad);
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
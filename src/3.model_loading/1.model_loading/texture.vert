@@ -1,6 +1,11 @@
 #version 330 core
+#ifdef COMPACT_VERTICES
+layout (location = 0) in vec3 aPosition; // within the mesh bounds, 0 to 1 on every axis
+layout (location = 1) in vec2 aNormal; // octahedral
+#else
 layout (location = 0) in vec3 aPosition;
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
@@ -11,10 +16,39 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+#ifdef COMPACT_VERTICES
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 decodePosition()
+{
+  return positionOffset + aPosition * positionScale;
+}
+
+vec3 decodeNormal()
+{
+  vec3 normal = vec3(aNormal, 1.0 - abs(aNormal.x) - abs(aNormal.y));
+  if (normal.z < 0.0)
+    normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+  return normalize(normal);
+}
+#else
+vec3 decodePosition()
+{
+  return aPosition;
+}
+
+vec3 decodeNormal()
+{
+  return aNormal;
+}
+#endif
+
 void main()
 {
-  FragmentPosition = vec3(model * vec4(aPosition, 1.0));
-  Normal = mat3(transpose(inverse(model))) * aNormal;  
+  vec3 position = decodePosition();
+  FragmentPosition = vec3(model * vec4(position, 1.0));
+  Normal = mat3(transpose(inverse(model))) * decodeNormal();  
   TexCoords = aTexCoords;    
-  gl_Position = projection * view * model * vec4(aPosition, 1.0);
+  gl_Position = projection * view * model * vec4(position, 1.0);
 }
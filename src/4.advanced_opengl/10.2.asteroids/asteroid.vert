@@ -1,6 +1,11 @@
 #version 330 core
+#ifdef COMPACT_VERTICES
+layout (location = 0) in vec3 aPos; // within the mesh bounds, 0 to 1 on every axis
+layout (location = 1) in vec2 aNormal; // octahedral, unused here
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in mat4 aModel;
 
@@ -9,8 +14,23 @@ out vec2 TexCoords;
 uniform mat4 projection;
 uniform mat4 view;
 
+#ifdef COMPACT_VERTICES
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 decodePosition()
+{
+    return positionOffset + aPos * positionScale;
+}
+#else
+vec3 decodePosition()
+{
+    return aPos;
+}
+#endif
+
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * aModel * vec4(aPos, 1.0f); 
+    gl_Position = projection * view * aModel * vec4(decodePosition(), 1.0f); 
 }
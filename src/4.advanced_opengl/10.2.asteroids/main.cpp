@@ -5,6 +5,9 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -12,6 +15,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 
@@ -46,6 +50,25 @@ struct MeshVertex
   glm::vec2 textureCoordinate;
 };
 
+// the optional compact format, 16 bytes instead of 32: the position as 16 bit unorm within the mesh bounds (the fourth
+// value only pads), the normal octahedral encoded into two 16 bit snorm and the texture coordinate as two half floats
+struct CompactVertex
+{
+  uint16_t position[4];
+  int16_t normal[2];
+  uint16_t textureCoordinate[2];
+};
+
+// the largest difference between a mesh's vertices and what the shaders decode from its compact vertices
+struct CompactMeshReport
+{
+  float positionError; // in model units
+  float normalError; // in degrees
+  float textureCoordinateError;
+  size_t fullBytes;
+  size_t compactBytes;
+};
+
 struct Texture
 {
   unsigned int id;
@@ -58,6 +81,10 @@ struct Mesh
   std::vector<MeshVertex> vertices;
   std::vector<unsigned int> indices;
   std::vector<Texture> textures;
+  glm::vec3 minimum;
+  glm::vec3 maximum;
+  bool compact; // CompactVertex instead of MeshVertex, the shaders then need COMPACT_VERTICES
+  GLenum indexType; // GL_UNSIGNED_SHORT for compact meshes whose indices fit
   unsigned int vao;
   unsigned int vbo;
   unsigned int ebo;
@@ -73,6 +100,7 @@ struct ModelLoadContext
   std::filesystem::path filename;
   std::filesystem::path directory;
   std::vector<Texture> textures;
+  bool compactVertices;
 };
 
 std::stringstream readFile(std::filesystem::path path)
@@ -101,9 +129,16 @@ unsigned int createShader(const char* source, GLenum type)
   return shader;
 }
 
-unsigned int loadShader(std::filesystem::path path, GLenum type)
+// the defines go right after the #version line, which has to stay first
+unsigned int loadShader(std::filesystem::path path, GLenum type, std::vector<std::string> defines = {})
 {
   std::string source = readFile(path).str();
+  size_t lineEnd = source.find('\n');
+  size_t position = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+  for (std::string& define : defines)
+  {
+    source.insert(position, "#define " + define + "\n");
+  }
   return createShader(source.c_str(), type);
 }
 
@@ -202,6 +237,10 @@ Mesh loadModelMesh(aiMesh *aiMesh, const aiScene *scene, ModelLoadContext& conte
     .vertices = {},
     .indices = {},
     .textures = {},
+    .minimum = glm::vec3(INFINITY),
+    .maximum = glm::vec3(-INFINITY),
+    .compact = false,
+    .indexType = GL_UNSIGNED_INT,
   };
   for (unsigned int i = 0; i < aiMesh->mNumVertices; i++)
   {
@@ -221,6 +260,8 @@ Mesh loadModelMesh(aiMesh *aiMesh, const aiScene *scene, ModelLoadContext& conte
     textureCoordinate.y = aiMesh->mTextureCoords[0][i].y;
     vertex.textureCoordinate = textureCoordinate;
     mesh.vertices.push_back(vertex);
+    mesh.minimum = glm::min(mesh.minimum, position);
+    mesh.maximum = glm::max(mesh.maximum, position);
   }
   for (unsigned int i = 0; i < aiMesh->mNumFaces; i++)
   {
@@ -260,6 +301,128 @@ std::vector<Mesh> loadModelMeshes(aiNode *node, const aiScene *scene, ModelLoadC
   return meshes;
 }
 
+float signNotZero(float value)
+{
+  return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// the normal projected onto the octahedron and the lower half folded over the upper, both coordinates in [-1, 1]
+glm::vec2 encodeOctahedral(glm::vec3 normal)
+{
+  float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (length == 0.0f)
+  {
+    return glm::vec2(0.0f, 0.0f);
+  }
+  normal /= length;
+  if (normal.z >= 0.0f)
+  {
+    return glm::vec2(normal.x, normal.y);
+  }
+  return glm::vec2((1.0f - std::abs(normal.y)) * signNotZero(normal.x), (1.0f - std::abs(normal.x)) * signNotZero(normal.y));
+}
+
+glm::vec3 decodeOctahedral(glm::vec2 encoded)
+{
+  glm::vec3 normal = glm::vec3(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+  if (normal.z < 0.0f)
+  {
+    normal = glm::vec3((1.0f - std::abs(normal.y)) * signNotZero(normal.x), (1.0f - std::abs(normal.x)) * signNotZero(normal.y), normal.z);
+  }
+  return glm::normalize(normal);
+}
+
+uint16_t quantizeUnorm16(float value)
+{
+  return (uint16_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+int16_t quantizeSnorm16(float value)
+{
+  return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+// compact vertices followed by the indices, 16 bit when every index fits; the report compares each vertex with what
+// decoding its compact form gives back
+std::vector<uint8_t> packCompactMesh(Mesh& mesh, CompactMeshReport& report)
+{
+  glm::vec3 scale = mesh.maximum - mesh.minimum;
+  bool shortIndices = mesh.vertices.size() <= UINT16_MAX + 1u;
+  size_t vertexBytes = mesh.vertices.size() * sizeof(CompactVertex);
+  std::vector<uint8_t> packed(vertexBytes + mesh.indices.size() * (shortIndices ? sizeof(uint16_t) : sizeof(unsigned int)));
+  report = CompactMeshReport
+  { .positionError = 0.0f,
+    .normalError = 0.0f,
+    .textureCoordinateError = 0.0f,
+    .fullBytes = mesh.vertices.size() * sizeof(MeshVertex) + mesh.indices.size() * sizeof(unsigned int),
+    .compactBytes = packed.size()
+  };
+  for (unsigned int i = 0; i < mesh.vertices.size(); i++)
+  {
+    MeshVertex& vertex = mesh.vertices[i];
+    CompactVertex compact = {};
+    glm::vec3 decodedPosition = mesh.minimum;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      float relative = scale[axis] > 0.0f ? (vertex.position[axis] - mesh.minimum[axis]) / scale[axis] : 0.0f;
+      compact.position[axis] = quantizeUnorm16(relative);
+      decodedPosition[axis] += compact.position[axis] / 65535.0f * scale[axis];
+    }
+    glm::vec2 octahedral = encodeOctahedral(vertex.normal);
+    compact.normal[0] = quantizeSnorm16(octahedral.x);
+    compact.normal[1] = quantizeSnorm16(octahedral.y);
+    glm::vec3 decodedNormal = decodeOctahedral(glm::vec2(compact.normal[0] / 32767.0f, compact.normal[1] / 32767.0f));
+    compact.textureCoordinate[0] = glm::packHalf1x16(vertex.textureCoordinate.x);
+    compact.textureCoordinate[1] = glm::packHalf1x16(vertex.textureCoordinate.y);
+    glm::vec2 decodedTextureCoordinate = glm::vec2(glm::unpackHalf1x16(compact.textureCoordinate[0]), glm::unpackHalf1x16(compact.textureCoordinate[1]));
+    std::memcpy(packed.data() + i * sizeof(CompactVertex), &compact, sizeof(CompactVertex));
+    report.positionError = std::max(report.positionError, glm::length(decodedPosition - vertex.position));
+    if (glm::length(vertex.normal) > 0.0f)
+    {
+      float cosine = std::clamp(glm::dot(glm::normalize(vertex.normal), decodedNormal), -1.0f, 1.0f);
+      report.normalError = std::max(report.normalError, glm::degrees(std::acos(cosine)));
+    }
+    glm::vec2 textureCoordinateDifference = glm::abs(decodedTextureCoordinate - vertex.textureCoordinate);
+    report.textureCoordinateError = std::max(report.textureCoordinateError, std::max(textureCoordinateDifference.x, textureCoordinateDifference.y));
+  }
+  for (unsigned int i = 0; i < mesh.indices.size(); i++)
+  {
+    if (shortIndices)
+    {
+      uint16_t shortIndex = (uint16_t)mesh.indices[i];
+      std::memcpy(packed.data() + vertexBytes + i * sizeof(uint16_t), &shortIndex, sizeof(uint16_t));
+    }
+    else
+    {
+      std::memcpy(packed.data() + vertexBytes + i * sizeof(unsigned int), &mesh.indices[i], sizeof(unsigned int));
+    }
+  }
+  mesh.compact = true;
+  mesh.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  return packed;
+}
+
+void setupCompactMesh(Mesh& mesh, CompactMeshReport& report)
+{
+  std::vector<uint8_t> packed = packCompactMesh(mesh, report);
+  size_t vertexBytes = mesh.vertices.size() * sizeof(CompactVertex);
+  glGenVertexArrays(1, &mesh.vao);
+  glGenBuffers(1, &mesh.vbo);
+  glGenBuffers(1, &mesh.ebo);
+  glBindVertexArray(mesh.vao);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertexBytes, packed.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)(offsetof(CompactVertex, position)));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)(offsetof(CompactVertex, normal)));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)(offsetof(CompactVertex, textureCoordinate)));
+  glEnableVertexAttribArray(2);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.size() - vertexBytes, packed.data() + vertexBytes, GL_STATIC_DRAW);
+  glBindVertexArray(0);
+}
+
 void setupMesh(Mesh& mesh)
 {
   glGenVertexArrays(1, &mesh.vao);
@@ -290,9 +453,27 @@ Model loadModel(ModelLoadContext& context)
     return model;
   }
   model.meshes = loadModelMeshes(aiScene->mRootNode, aiScene, context);
-  for (Mesh& mesh : model.meshes)
+  CompactMeshReport total = {};
+  for (unsigned int i = 0; i < model.meshes.size(); i++)
   {
-    setupMesh(mesh);
+    Mesh& mesh = model.meshes[i];
+    if (!context.compactVertices)
+    {
+      setupMesh(mesh);
+      continue;
+    }
+    CompactMeshReport report;
+    setupCompactMesh(mesh, report);
+    total.fullBytes += report.fullBytes;
+    total.compactBytes += report.compactBytes;
+    std::cout << "COMPACT_MESH:: " << context.filename.filename().string() << " " << i << ": " << mesh.vertices.size() << " vertices, "
+              << report.fullBytes << " -> " << report.compactBytes << " bytes, position error " << report.positionError
+              << ", normal error " << report.normalError << " degrees, texture coordinate error " << report.textureCoordinateError << std::endl;
+  }
+  if (context.compactVertices)
+  {
+    std::cout << "COMPACT_MESH:: " << context.filename.filename().string() << " " << total.fullBytes << " -> " << total.compactBytes
+              << " bytes" << std::endl;
   }
   return model;
 }
@@ -322,8 +503,13 @@ void drawMesh(Mesh& mesh, unsigned int shaderProgram, unsigned int amount)
     glBindTexture(GL_TEXTURE_2D, texture.id);
   }
   glActiveTexture(GL_TEXTURE0);
+  if (mesh.compact)
+  {
+    glUniform3fv(glGetUniformLocation(shaderProgram, "positionOffset"), 1, glm::value_ptr(mesh.minimum));
+    glUniform3fv(glGetUniformLocation(shaderProgram, "positionScale"), 1, glm::value_ptr(mesh.maximum - mesh.minimum));
+  }
   glBindVertexArray(mesh.vao);
-  glDrawElementsInstanced(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0, amount);
+  glDrawElementsInstanced(GL_TRIANGLES, mesh.indices.size(), mesh.indexType, 0, amount);
   glBindVertexArray(0);
 }
 
@@ -416,9 +602,23 @@ void handleFrameBufferSizeUpdate(GLFWwindow* window, int width, int height)
   glViewport(0, 0, width, height);
 }
 
-int main()
+int main(int argc, char** argv)
 {
   std::tuple<int,int> glVersion = {3, 3};
+  bool compactVertices = false;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    std::string flag = argv[i];
+    if (flag == "--compact-vertices")
+      compactVertices = std::stoi(argv[i + 1]) != 0;
+    else
+      std::cout << "Unknown flag: " << flag << std::endl;
+  }
+  std::vector<std::string> vertexShaderDefines = {};
+  if (compactVertices)
+  {
+    vertexShaderDefines.push_back("COMPACT_VERTICES");
+  }
   int windowWidth = 800, windowHeight = 600;
   std::string windowTitle = {WINDOW_TITLE};
   std::filesystem::path staticFilePath = {STATIC_FILE_PATH};
@@ -444,13 +644,13 @@ int main()
   }
   std::vector<unsigned int> asteroidShaders =
   {
-    loadShader(staticFilePath / "asteroid.vert", GL_VERTEX_SHADER),
+    loadShader(staticFilePath / "asteroid.vert", GL_VERTEX_SHADER, vertexShaderDefines),
     loadShader(staticFilePath / "asteroid.frag", GL_FRAGMENT_SHADER),
   };
   unsigned int asteroidShaderProgram = createShaderProgram(asteroidShaders);
   std::vector<unsigned int> planetShaders =
   {
-    loadShader(staticFilePath / "planet.vert", GL_VERTEX_SHADER),
+    loadShader(staticFilePath / "planet.vert", GL_VERTEX_SHADER, vertexShaderDefines),
     loadShader(staticFilePath / "planet.frag", GL_FRAGMENT_SHADER),
   };
   unsigned int planetShaderProgram = createShaderProgram(planetShaders);
@@ -458,14 +658,16 @@ int main()
   {
     .directory = staticFilePath / "resources/rock",
     .filename = staticFilePath / "resources/rock/rock.obj",
-    .textures = {}
+    .textures = {},
+    .compactVertices = compactVertices
   };
   Model asteroid = loadModel(asteroidLoadContext);
   ModelLoadContext planetLoadContext =
   {
     .directory = staticFilePath / "resources/planet",
     .filename = staticFilePath / "resources/planet/planet.obj",
-    .textures = {}
+    .textures = {},
+    .compactVertices = compactVertices
   };
   Model planet = loadModel(planetLoadContext);
   unsigned int amount = 10000;
@@ -1,6 +1,11 @@
 #version 330 core
+#ifdef COMPACT_VERTICES
+layout (location = 0) in vec3 aPos; // within the mesh bounds, 0 to 1 on every axis
+layout (location = 1) in vec2 aNormal; // octahedral, unused here
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
@@ -9,9 +14,23 @@ uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
+#ifdef COMPACT_VERTICES
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 decodePosition()
+{
+    return positionOffset + aPos * positionScale;
+}
+#else
+vec3 decodePosition()
+{
+    return aPos;
+}
+#endif
+
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * model * vec4(aPos, 1.0f); 
+    gl_Position = projection * view * model * vec4(decodePosition(), 1.0f); 
 }
-
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <bit>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+#if defined(__x86_64__) || defined(__i386__)
+#define BRICK_FIELD_X86
+#include <immintrin.h>
+#endif
+
+const unsigned int BRICK_FIELD_LANES = 8;
+
+// brick bounds as structure of arrays so the collision kernel loads 8 boxes at a time,
+// every array keeps BRICK_FIELD_LANES dead boxes past the last brick so a kernel may start at any brick
+struct BrickField
+{
+  unsigned int count;
+  std::vector<float> minX;
+  std::vector<float> minY;
+  std::vector<float> maxX;
+  std::vector<float> maxY;
+  std::vector<uint32_t> alive; // all bits set for a live brick so it doubles as a lane mask
+};
+
+using BrickBoxKernel = unsigned int (*)(const BrickField& field, unsigned int first, float centerX, float centerY, float radius);
+
+// capacity is the number of bricks expected, adding more still works but reallocates
+BrickField createBrickField(unsigned int capacity = 0)
+{
+  BrickField field =
+  { .count = 0,
+    .minX = std::vector<float>(BRICK_FIELD_LANES, 0.0f),
+    .minY = std::vector<float>(BRICK_FIELD_LANES, 0.0f),
+    .maxX = std::vector<float>(BRICK_FIELD_LANES, 0.0f),
+    .maxY = std::vector<float>(BRICK_FIELD_LANES, 0.0f),
+    .alive = std::vector<uint32_t>(BRICK_FIELD_LANES, 0)
+  };
+  field.minX.reserve(capacity + BRICK_FIELD_LANES);
+  field.minY.reserve(capacity + BRICK_FIELD_LANES);
+  field.maxX.reserve(capacity + BRICK_FIELD_LANES);
+  field.maxY.reserve(capacity + BRICK_FIELD_LANES);
+  field.alive.reserve(capacity + BRICK_FIELD_LANES);
+  return field;
+}
+
+void addBrickToField(BrickField& field, glm::vec2 topLeft, glm::vec2 bottomRight)
+{
+  field.minX[field.count] = topLeft.x;
+  field.minY[field.count] = topLeft.y;
+  field.maxX[field.count] = bottomRight.x;
+  field.maxY[field.count] = bottomRight.y;
+  field.alive[field.count] = 0xffffffff;
+  field.minX.push_back(0.0f);
+  field.minY.push_back(0.0f);
+  field.maxX.push_back(0.0f);
+  field.maxY.push_back(0.0f);
+  field.alive.push_back(0);
+  field.count++;
+}
+
+// the kernels mirror checkCircleToBoxCollision operation for operation so both agree on every box,
+// bit i of the result is set when the circle touches live box first + i
+unsigned int checkCircleToBrickBoxesScalar(const BrickField& field, unsigned int first, float centerX, float centerY, float radius)
+{
+  unsigned int hits = 0;
+  for (unsigned int lane = 0; lane < BRICK_FIELD_LANES; lane++)
+  {
+    unsigned int i = first + lane;
+    float halfX = (field.maxX[i] - field.minX[i]) / 2.0f;
+    float halfY = (field.maxY[i] - field.minY[i]) / 2.0f;
+    float boxCenterX = field.minX[i] + halfX;
+    float boxCenterY = field.minY[i] + halfY;
+    float differenceX = boxCenterX + std::min(std::max(centerX - boxCenterX, -halfX), halfX) - centerX;
+    float differenceY = boxCenterY + std::min(std::max(centerY - boxCenterY, -halfY), halfY) - centerY;
+    bool hit = !(std::sqrt(differenceX * differenceX + differenceY * differenceY) > radius) && field.alive[i] != 0;
+    hits |= (unsigned int)hit << lane;
+  }
+  return hits;
+}
+
+#ifdef BRICK_FIELD_X86
+__attribute__((target("sse2")))
+unsigned int checkCircleToBrickBoxesSse(const BrickField& field, unsigned int first, float centerX, float centerY, float radius)
+{
+  __m128 half = _mm_set1_ps(0.5f);
+  __m128 sign = _mm_set1_ps(-0.0f);
+  __m128 circleX = _mm_set1_ps(centerX);
+  __m128 circleY = _mm_set1_ps(centerY);
+  __m128 circleRadius = _mm_set1_ps(radius);
+  unsigned int hits = 0;
+  for (unsigned int lane = 0; lane < BRICK_FIELD_LANES; lane += 4)
+  {
+    unsigned int i = first + lane;
+    __m128 minX = _mm_loadu_ps(&field.minX[i]);
+    __m128 minY = _mm_loadu_ps(&field.minY[i]);
+    __m128 halfX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&field.maxX[i]), minX), half);
+    __m128 halfY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&field.maxY[i]), minY), half);
+    __m128 boxCenterX = _mm_add_ps(minX, halfX);
+    __m128 boxCenterY = _mm_add_ps(minY, halfY);
+    __m128 clampedX = _mm_min_ps(_mm_max_ps(_mm_sub_ps(circleX, boxCenterX), _mm_xor_ps(halfX, sign)), halfX);
+    __m128 clampedY = _mm_min_ps(_mm_max_ps(_mm_sub_ps(circleY, boxCenterY), _mm_xor_ps(halfY, sign)), halfY);
+    __m128 differenceX = _mm_sub_ps(_mm_add_ps(boxCenterX, clampedX), circleX);
+    __m128 differenceY = _mm_sub_ps(_mm_add_ps(boxCenterY, clampedY), circleY);
+    __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(differenceX, differenceX), _mm_mul_ps(differenceY, differenceY)));
+    __m128 alive = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&field.alive[i]));
+    __m128 hit = _mm_and_ps(_mm_cmpngt_ps(distance, circleRadius), alive);
+    hits |= (unsigned int)_mm_movemask_ps(hit) << lane;
+  }
+  return hits;
+}
+
+__attribute__((target("avx2")))
+unsigned int checkCircleToBrickBoxesAvx2(const BrickField& field, unsigned int first, float centerX, float centerY, float radius)
+{
+  __m256 half = _mm256_set1_ps(0.5f);
+  __m256 sign = _mm256_set1_ps(-0.0f);
+  __m256 circleX = _mm256_set1_ps(centerX);
+  __m256 circleY = _mm256_set1_ps(centerY);
+  __m256 minX = _mm256_loadu_ps(&field.minX[first]);
+  __m256 minY = _mm256_loadu_ps(&field.minY[first]);
+  __m256 halfX = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&field.maxX[first]), minX), half);
+  __m256 halfY = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&field.maxY[first]), minY), half);
+  __m256 boxCenterX = _mm256_add_ps(minX, halfX);
+  __m256 boxCenterY = _mm256_add_ps(minY, halfY);
+  __m256 clampedX = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(circleX, boxCenterX), _mm256_xor_ps(halfX, sign)), halfX);
+  __m256 clampedY = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(circleY, boxCenterY), _mm256_xor_ps(halfY, sign)), halfY);
+  __m256 differenceX = _mm256_sub_ps(_mm256_add_ps(boxCenterX, clampedX), circleX);
+  __m256 differenceY = _mm256_sub_ps(_mm256_add_ps(boxCenterY, clampedY), circleY);
+  // separate multiply and add rather than fma, fused rounding would disagree with the scalar test on edge contacts
+  __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(differenceX, differenceX), _mm256_mul_ps(differenceY, differenceY)));
+  __m256 alive = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)&field.alive[first]));
+  __m256 hit = _mm256_and_ps(_mm256_cmp_ps(distance, _mm256_set1_ps(radius), _CMP_NGT_UQ), alive);
+  return (unsigned int)_mm256_movemask_ps(hit);
+}
+#endif
+
+BrickBoxKernel selectBrickBoxKernel()
+{
+#ifdef BRICK_FIELD_X86
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return checkCircleToBrickBoxesAvx2;
+  }
+  return checkCircleToBrickBoxesSse;
+#else
+  return checkCircleToBrickBoxesScalar;
+#endif
+}
+
+unsigned int checkCircleToBrickBoxes(const BrickField& field, unsigned int first, float centerX, float centerY, float radius)
+{
+  static BrickBoxKernel kernel = selectBrickBoxKernel();
+  return kernel(field, first, centerX, centerY, radius);
+}
+
+// visits the live bricks in [first, last] touched by the circle in index order, testing 8 boxes per kernel call
+template <typename Visitor>
+void forEachBrickHit(const BrickField& field, unsigned int first, unsigned int last, float centerX, float centerY, float radius, Visitor visit)
+{
+  for (unsigned int chunk = first; chunk <= last; chunk += BRICK_FIELD_LANES)
+  {
+    unsigned int lanes = std::min(BRICK_FIELD_LANES, last - chunk + 1);
+    unsigned int hits = checkCircleToBrickBoxes(field, chunk, centerX, centerY, radius) & ((1u << lanes) - 1);
+    while (hits != 0)
+    {
+      visit(chunk + std::countr_zero(hits));
+      hits &= hits - 1;
+    }
+  }
+}
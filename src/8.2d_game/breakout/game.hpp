@@ -0,0 +1,2096 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <tuple>
+#include <vector>
+#include <string>
+#include <optional>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "brick_field.hpp"
+#include "particle_field.hpp"
+#include "level_file.hpp"
+#include "random.hpp"
+#include "resources.hpp"
+
+struct Texture
+{
+  // holds the ID of the texture object, used for all texture operations to reference to this particular texture
+  unsigned int id;
+  // texture image dimensions
+  int width;
+  int height; // width and height of loaded image in pixels
+  int channels;
+};
+
+struct SpriteVertex
+{
+  glm::vec2 position;
+  glm::vec2 textureCoordinate;
+};
+
+// where the sprite's image sits in the shared texture atlas, <vec2 offset, vec2 size> in texture coordinates
+struct Sprite
+{
+  glm::vec4 textureRect;
+};
+
+struct ParticleVertex
+{
+  glm::vec2 position;
+  glm::vec2 textureCoordinate;
+};
+
+struct ParticleIntanceVertex
+{
+  glm::vec2 offset;
+  glm::vec4 color;
+};
+
+struct Particle
+{
+  glm::vec4 textureRect;
+  std::vector<ParticleVertex> vertices;
+  unsigned int vao;
+  unsigned int vbo;
+  unsigned int instanceVbo;
+  unsigned int instanceCapacity;
+};
+
+// the resources levels share; textures and shaders are the GL object names, the registry only hands them out
+struct ResourceRegistry
+{
+  ResourceTable<Sprite> sprites;
+  ResourceTable<unsigned int> textures;
+  ResourceTable<unsigned int> shaders;
+  ResourceTable<Particle> particles;
+};
+
+ResourceRegistry createResourceRegistry()
+{
+  return ResourceRegistry
+  { .sprites = createResourceTable(Sprite { .textureRect = glm::vec4(0.0f) }),
+    .textures = createResourceTable(0u),
+    .shaders = createResourceTable(0u),
+    .particles = createResourceTable(Particle { .textureRect = glm::vec4(0.0f), .vertices = {}, .vao = 0, .vbo = 0, .instanceVbo = 0, .instanceCapacity = 0 })
+  };
+}
+
+struct ScreenEffects
+{
+  bool confuse;
+  bool chaos;
+  bool shake;
+};
+
+struct ShakeEffectConfig
+{
+  float duration;
+};
+
+struct ShakeEffect
+{
+  float ttl;
+};
+
+struct EntityAttributes
+{
+  glm::vec2 position;
+  glm::vec2 size;
+  float rotation;
+  glm::vec3 color;
+};
+
+enum TileType
+{
+  TILE_TYPE_SOLID,
+  TILE_TYPE_EMPTY,
+  TILE_TYPE_DESTROYABLE
+};
+
+struct Tile
+{
+  TileType type;
+  glm::vec3 color;
+};
+
+// tiles are row-major indices into the palette, they point either into a memory mapped level file or into storage the
+// map owns; copies share that storage, so configs holding a map stay cheap to copy
+struct TileMap
+{
+  unsigned int columns;
+  unsigned int rows;
+  unsigned int brickCount;
+  std::vector<Tile> palette;
+  const uint8_t* tiles;
+  std::shared_ptr<const void> storage;
+};
+
+enum Direction
+{
+  DIRECTION_UP,
+  DIRECTION_DOWN,
+  DIRECTION_LEFT,
+  DIRECTION_RIGHT,
+};
+
+struct Collision
+{
+  Direction direction;
+  glm::vec2 difference;
+};
+
+struct AabbCollisionBox
+{
+  glm::vec2 topLeft;
+  glm::vec2 bottomRight;
+};
+
+struct AabbCollisionCircle
+{
+  float radius;
+  glm::vec2 center;
+};
+
+// time of impact of a moving circle against a box, with the contact normal pointing from the box to the circle
+struct SweptCollision
+{
+  float time;
+  glm::vec2 normal;
+};
+
+enum GameObjectBodyType
+{
+  GAME_OBJECT_BODY_SOLID,
+  GAME_OBJECT_BODY_DESTROYABLE
+};
+
+enum GameObjectStatus
+{
+  GAME_OBJECT_ALIVE,
+  GAME_OBJECT_DESTROYED,
+};
+
+struct GameObject
+{
+  glm::vec2 position;
+  glm::vec2 size;
+  float rotation;
+  glm::vec3 color;
+  GameObjectBodyType bodyType;
+  GameObjectStatus status;
+};
+
+enum ParticleBackend
+{
+  PARTICLE_BACKEND_CPU,
+  PARTICLE_BACKEND_GPU,
+};
+
+const unsigned int BALL_PARTICLE_COUNT = 500;
+const float BALL_PARTICLE_FADE_RATE = 2.5f;
+
+enum BallObjectSurfaceType
+{
+  BALL_OBJECT_SURFACE_STICKY,
+  BALL_OBJECT_SURFACE_REFLECT,
+};
+
+enum BallObjectCollisionType
+{
+  BALL_OBJECT_COLLISION_DEFAULT,
+  BALL_OBJECT_COLLISION_PASS_THROUGH,
+};
+
+struct BallConfig
+{
+  float speed;
+  float radius;
+  glm::vec3 color;
+  SpriteHandle sprite;
+  unsigned int count; // balls a level starts with, the first one sits on the paddle and the rest start in flight
+  bool floorReflects; // keeps every ball in play, the stress configuration uses it to hold the load steady
+  unsigned int particleCount; // size of the trail all balls share
+  ParticleBackend particleBackend;
+  ParticleHandle particleModel;
+};
+
+// one ball gathered out of the level's ball field, the collision code works on these
+struct BallObject : GameObject
+{
+  float speed;
+  float radius;
+  glm::vec2 velocity;
+  glm::vec2 previousPosition;
+  // the ball travels in straight lines between contacts, its position is worked out from where the current line started
+  // and how long it has been followed rather than accumulated step by step
+  glm::vec2 pathOrigin;
+  float pathTime;
+  BallObjectSurfaceType surfaceType;
+  BallObjectCollisionType collisionType;
+};
+
+// every ball of a level as structure of arrays, the first count are in play; all balls share size, speed and color, and
+// a lost ball is compacted away keeping the order of the rest. the arrays are sized for every ball the level starts with
+// and never change size, so snapshots copy them without allocating
+struct BallField
+{
+  unsigned int count;
+  float speed;
+  float radius;
+  glm::vec3 color;
+  std::vector<glm::vec2> position;
+  std::vector<glm::vec2> previousPosition;
+  std::vector<glm::vec2> velocity;
+  std::vector<glm::vec2> pathOrigin;
+  std::vector<float> pathTime;
+  std::vector<BallObjectSurfaceType> surfaceType;
+  std::vector<BallObjectCollisionType> collisionType;
+};
+
+// the particle trail every ball emits into
+struct BallTrail
+{
+  // with the gpu backend the field only queues the particles spawned since the last frame, and particleTime is how far the
+  // renderer has to step them together with the ones already on the gpu
+  ParticleField particles;
+  ParticleBackend particleBackend;
+  float particleTime;
+  // gpu backend only, the particleTime each queued particle was spawned at: one spawned in a later step is stepped by
+  // less, the time before it existed is taken off. sized for the whole trail once so restoring a snapshot never allocates
+  std::vector<float> spawnTimes;
+  unsigned int emitter; // the ball that emits first, it moves on every step so a full trail is shared out over all balls
+};
+
+// a brick a ball hit during a step, bricks are only changed once every ball has moved
+struct BallBrickHit
+{
+  float time; // into the step
+  unsigned int ball;
+  unsigned int order; // among the hits of the same ball
+  unsigned int brick;
+};
+
+enum BallContactType
+{
+  BALL_CONTACT_WALL,
+  BALL_CONTACT_FLOOR,
+  BALL_CONTACT_BRICK,
+  BALL_CONTACT_PLAYER,
+};
+
+struct BallContact
+{
+  BallContactType type;
+  unsigned int brick;
+  float time;
+  glm::vec2 normal;
+};
+
+// contacts closer together than this along the ball's path, in pixels, are resolved together
+const float BALL_CONTACT_TOLERANCE = 0.001f;
+const unsigned int BALL_SWEEP_MAX_CONTACTS = 8;
+// a step that runs out of sweeps drops the rest of its travel rather than move the ball unchecked
+const unsigned int BALL_OBJECT_MAX_SWEEPS = 16;
+
+// the earliest contacts along the ball's current path, times are measured from the start of the path
+struct BallSweep
+{
+  float time;
+  float tolerance;
+  unsigned int count;
+  std::array<BallContact, BALL_SWEEP_MAX_CONTACTS> contacts;
+};
+
+struct PlayerConfig
+{
+  float velocity;
+  glm::vec2 size;
+  glm::vec3 color;
+  SpriteHandle sprite;
+};
+
+struct PlayerObject : GameObject
+{
+  float velocity;
+  float previousX; // where the paddle was before the last step, for rendering between steps
+};
+
+enum PowerUpType
+{
+  POWER_UP_SPEED,
+  POWER_UP_STICKY,
+  POWER_UP_PASS_THROUGH,
+  POWER_UP_PADDLE_SIZE_UP,
+  POWER_UP_CONFUSION,
+  POWER_UP_CHAOS,
+};
+
+const unsigned int POWER_UP_TYPE_COUNT = POWER_UP_CHAOS + 1;
+const unsigned int POWER_UP_POOL_CAPACITY = 1024;
+
+struct PowerUpConfig
+{
+  PowerUpType type;
+  int chance; // one in chance bricks drops the power up, 0 never drops it
+  float ttl;
+  SpriteHandle sprite;
+  glm::vec2 velocity;
+  glm::vec2 size;
+  glm::vec3 color;
+};
+
+// a falling power up is plain data, its type indexes the config holding the sprite and color it is drawn with
+struct PowerUpObject
+{
+  PowerUpType type;
+  glm::vec2 position;
+  glm::vec2 size;
+  glm::vec2 velocity;
+};
+
+enum PowerUpEffectStatus
+{
+  POWER_UP_EFFECT_IDLE,
+  POWER_UP_EFFECT_STATUS_ACTIVATE,
+  POWER_UP_EFFECT_STATUS_ACTIVATED,
+  POWER_UP_EFFECT_STATUS_DEACTIVATE,
+  POWER_UP_EFFECT_STATUS_DEACTIVATED
+};
+
+struct PowerUpEffect
+{
+  PowerUpType type;
+  float ttl;
+  PowerUpEffectStatus status;
+};
+
+// fixed capacity storage allocated once, the first count items are live and removing one moves the last live item
+// into its slot, so neither adding nor removing allocates or shifts the items behind it
+template <typename Item>
+struct Pool
+{
+  unsigned int count;
+  std::vector<Item> items;
+};
+
+// random streams of a level, drawn from its seed
+enum GameLevelRandomStream
+{
+  GAME_LEVEL_RANDOM_POWER_UPS,
+  GAME_LEVEL_RANDOM_PARTICLES,
+};
+
+struct GameLevelConfig
+{
+  TileMap tileMap;
+  unsigned int width;
+  unsigned int height;
+  uint64_t seed; // every random draw of the level comes from streams seeded with this, so equal inputs replay equally
+  PlayerConfig playerConfig;
+  BallConfig ballConfig;
+  ShakeEffectConfig shakeEffectConfig;
+  std::array<PowerUpConfig, POWER_UP_TYPE_COUNT> powerUpConfigs; // indexed by PowerUpType
+  SpriteHandle background;
+  SpriteHandle blockSolid;
+  SpriteHandle blockDestroyable;
+  ShaderHandle spriteShader;
+  ShaderHandle particleShader;
+};
+
+// broad phase lookup of bricks by tile coordinate, a cell holds the index of its brick or -1,
+// whether the brick is still alive is tracked by the brick field
+struct BrickGrid
+{
+  unsigned int columns;
+  unsigned int rows;
+  glm::vec2 cellSize;
+  std::vector<int> cells;
+};
+
+struct GameLevelMap
+{
+  unsigned int width;
+  unsigned int height;
+  std::vector<GameObject> bricks;
+  BrickGrid brickGrid;
+  BrickField brickField;
+  glm::mat4 projection;
+  // bricks destroyed since the statuses were last restored, in the order they went, and how many restores there have
+  // been; a renderer that caches the bricks redraws only these, the list never outgrows the brick count
+  std::vector<unsigned int> destroyedBricks;
+  unsigned int restores;
+};
+
+// everything a level changes while it is played, the brick statuses are the only part of the map that changes;
+// every container keeps its size between saves, so saving over and restoring from a snapshot copy flat arrays of
+// plain data and never allocate
+struct GameLevelSnapshot
+{
+  std::vector<GameObjectStatus> brickStatuses;
+  PlayerObject player;
+  BallField balls;
+  BallTrail trail;
+  ScreenEffects screenEffects;
+  ShakeEffect shakeEffect;
+  Pool<PowerUpObject> powerUps;
+  Pool<PowerUpEffect> powerUpEffects;
+  RandomStream powerUpRandom;
+  RandomStream particleRandom;
+};
+
+// a level holds no GL resources of its own, sprites and shaders are only referenced from the config and the renderer
+// owns the rest, so levels can be created, copied and restarted without a GL context
+struct GameLevel
+{
+  std::shared_ptr<const GameLevelConfig> config; // shared with every copy of the level and never written
+  GameLevelMap map;
+  PlayerObject player;
+  BallField balls;
+  BallTrail trail;
+  std::vector<BallBrickHit> brickHits; // scratch for the step, keeps its capacity
+  ScreenEffects screenEffects;
+  ShakeEffect shakeEffect;
+  Pool<PowerUpObject> powerUps;
+  Pool<PowerUpEffect> powerUpEffects;
+  // power ups and the cosmetic particle trail draw from separate streams, so the particles never change the gameplay
+  RandomStream powerUpRandom;
+  RandomStream particleRandom;
+  GameLevelSnapshot initialState; // what a restart goes back to
+};
+
+enum GameStatus
+{
+  GAME_ACTIVE,
+  GAME_MENU,
+  GAME_WIN,
+};
+
+struct GameState
+{
+  int width;
+  int height;
+  GameStatus status;
+  unsigned int level;
+  GameLevel gameLevel; // the level being played, no other level is instantiated
+};
+
+struct GameInput
+{
+  bool left;
+  bool right;
+  bool launch;
+};
+
+struct UpdateState
+{
+  float deltaTime;
+  GameInput input;
+};
+
+// supplies the input for a simulation step, e.g. polled from a window, scripted or replayed from a recording
+using InputSource = std::function<GameInput(unsigned long step, GameLevel& gameLevel)>;
+
+// accumulator is the real time handed to the simulation that no step has used up yet, always below one timestep
+// after advanceSimulation
+struct Simulation
+{
+  float timestep;
+  unsigned long step;
+  float time;
+  float accumulator;
+};
+
+template <typename Item>
+Pool<Item> createPool(unsigned int capacity)
+{
+  return Pool<Item>
+  { .count = 0,
+    .items = std::vector<Item>(capacity)
+  };
+}
+
+// returns false and drops the item when the pool is full
+template <typename Item>
+bool addPoolItem(Pool<Item>& pool, Item item)
+{
+  if (pool.count == pool.items.size())
+  {
+    return false;
+  }
+  pool.items[pool.count++] = item;
+  return true;
+}
+
+template <typename Item>
+void removePoolItem(Pool<Item>& pool, unsigned int index)
+{
+  pool.items[index] = pool.items[--pool.count];
+}
+
+PowerUpObject createPowerUp(const PowerUpConfig& powerUpConfig, glm::vec2 position)
+{
+  return PowerUpObject
+  { .type = powerUpConfig.type,
+    .position = position,
+    .size = powerUpConfig.size,
+    .velocity = powerUpConfig.velocity
+  };
+}
+
+PowerUpEffect createPowerUpEffect(const PowerUpConfig& powerUpConfig)
+{
+  PowerUpEffect powerUpEffect = PowerUpEffect
+  {
+    .type = powerUpConfig.type,
+    .ttl = powerUpConfig.ttl,
+    .status = POWER_UP_EFFECT_STATUS_ACTIVATE
+  };
+  return powerUpEffect;
+}
+
+std::vector<std::vector<unsigned int>> loadTileData(std::filesystem::path path)
+{
+  std::vector<std::vector<unsigned int>> tileGrid;
+  unsigned int tileCode;
+  std::string line;
+  std::ifstream file;
+  file.open(path);
+  while (std::getline(file, line))
+  {
+    std::istringstream content(line);
+    std::vector<unsigned int> tileRow;
+    while (content >> tileCode)
+    {
+      tileRow.push_back(tileCode);
+    }
+    tileGrid.push_back(tileRow);
+  }
+  return tileGrid;
+}
+
+Tile createTile(unsigned int tileData)
+{
+  Tile tile;
+  if (tileData == 1)
+  {
+    tile.type = TILE_TYPE_SOLID;
+    tile.color = glm::vec3(0.8f, 0.8f, 0.7f);
+  }
+  else if (tileData > 1)
+  {
+    tile.type = TILE_TYPE_DESTROYABLE;
+    if (tileData == 2)
+    {
+      tile.color = glm::vec3(0.2f, 0.6f, 1.0f);
+    }
+    else if (tileData == 3)
+    {
+      tile.color = glm::vec3(0.0f, 0.7f, 0.0f);
+    }
+    else if (tileData == 4)
+    {
+      tile.color = glm::vec3(0.8f, 0.8f, 0.4f);
+    }
+    else if (tileData == 5)
+    {
+      tile.color = glm::vec3(1.0f, 0.5f, 0.0f);
+    }
+  }
+  else
+  {
+    tile.type = TILE_TYPE_EMPTY;
+    tile.color = glm::vec3(1.0f, 1.0f, 1.0f);
+  }
+  return tile;
+}
+
+// the level is as wide as its first row, shorter rows are padded with empty tiles and longer ones are cut off
+TileMap createTileMap(std::vector<std::vector<unsigned int>> tileData)
+{
+  unsigned int columns = tileData.empty() ? 0 : tileData[0].size();
+  unsigned int rows = tileData.size();
+  TileMap tileMap =
+  { .columns = columns,
+    .rows = rows,
+    .brickCount = 0,
+    .palette = { createTile(0) },
+    .tiles = nullptr,
+    .storage = nullptr
+  };
+  std::vector<unsigned int> paletteCodes = { 0 };
+  std::shared_ptr<std::vector<uint8_t>> tiles = std::make_shared<std::vector<uint8_t>>(columns * rows, 0);
+  for (unsigned int y = 0; y < rows; y++)
+  {
+    for (unsigned int x = 0; x < std::min(columns, (unsigned int)tileData[y].size()); x++)
+    {
+      unsigned int code = tileData[y][x];
+      unsigned int kind = std::find(paletteCodes.begin(), paletteCodes.end(), code) - paletteCodes.begin();
+      if (kind == paletteCodes.size())
+      {
+        if (kind > UINT8_MAX)
+        {
+          std::cout << "ERROR::LEVEL::TOO_MANY_TILE_KINDS, tile " << code << " is left empty" << std::endl;
+          continue;
+        }
+        paletteCodes.push_back(code);
+        tileMap.palette.push_back(createTile(code));
+      }
+      (*tiles)[y * columns + x] = kind;
+      tileMap.brickCount += tileMap.palette[kind].type != TILE_TYPE_EMPTY;
+    }
+  }
+  tileMap.tiles = tiles->data();
+  tileMap.storage = tiles;
+  return tileMap;
+}
+
+// the tiles are used straight from the mapping, only the few tile kinds are copied out; a file that is not a valid
+// level loads as an empty map
+TileMap loadLevelFile(std::filesystem::path path)
+{
+  TileMap tileMap = { .columns = 0, .rows = 0, .brickCount = 0, .palette = {}, .tiles = nullptr, .storage = nullptr };
+  std::shared_ptr<const MappedFile> file = mapFile(path);
+  LevelFileHeader header;
+  if (file == nullptr || file->size < sizeof(LevelFileHeader))
+  {
+    std::cout << "ERROR::LEVEL::FILE_NOT_READ " << path << std::endl;
+    return tileMap;
+  }
+  std::memcpy(&header, file->data, sizeof(LevelFileHeader));
+  size_t tilesOffset = sizeof(LevelFileHeader) + header.kindCount * sizeof(LevelFileTileKind);
+  if (std::memcmp(header.magic, LEVEL_FILE_MAGIC, sizeof(LEVEL_FILE_MAGIC)) != 0
+    || header.version != LEVEL_FILE_VERSION
+    || header.kindCount == 0
+    || header.kindCount > UINT8_MAX + 1
+    || file->size != tilesOffset + (size_t)header.columns * header.rows)
+  {
+    std::cout << "ERROR::LEVEL::INVALID_FILE " << path << std::endl;
+    return tileMap;
+  }
+  const uint8_t* tiles = file->data + tilesOffset;
+  uint8_t maxKind = 0;
+  for (size_t i = 0; i < (size_t)header.columns * header.rows; i++)
+  {
+    maxKind = std::max(maxKind, tiles[i]);
+  }
+  if (maxKind >= header.kindCount)
+  {
+    std::cout << "ERROR::LEVEL::INVALID_TILE_KIND " << path << std::endl;
+    return tileMap;
+  }
+  for (unsigned int i = 0; i < header.kindCount; i++)
+  {
+    LevelFileTileKind kind;
+    std::memcpy(&kind, file->data + sizeof(LevelFileHeader) + i * sizeof(LevelFileTileKind), sizeof(LevelFileTileKind));
+    tileMap.palette.push_back(Tile
+    { .type = (TileType)kind.type,
+      .color = glm::vec3(kind.color[0], kind.color[1], kind.color[2])
+    });
+  }
+  tileMap.columns = header.columns;
+  tileMap.rows = header.rows;
+  tileMap.brickCount = header.brickCount;
+  tileMap.tiles = tiles;
+  tileMap.storage = file;
+  return tileMap;
+}
+
+// compiled levels end in .level, anything else is read as a text level
+TileMap loadTileMap(std::filesystem::path path)
+{
+  if (path.extension() == ".level")
+  {
+    return loadLevelFile(path);
+  }
+  return createTileMap(loadTileData(path));
+}
+
+bool writeLevelFile(std::filesystem::path path, TileMap& tileMap)
+{
+  LevelFileHeader header =
+  { .magic = { LEVEL_FILE_MAGIC[0], LEVEL_FILE_MAGIC[1], LEVEL_FILE_MAGIC[2], LEVEL_FILE_MAGIC[3] },
+    .version = LEVEL_FILE_VERSION,
+    .columns = tileMap.columns,
+    .rows = tileMap.rows,
+    .kindCount = (uint32_t)tileMap.palette.size(),
+    .brickCount = tileMap.brickCount
+  };
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char*)&header, sizeof(LevelFileHeader));
+  for (Tile& tile : tileMap.palette)
+  {
+    LevelFileTileKind kind =
+    { .type = (uint32_t)tile.type,
+      .color = { tile.color.r, tile.color.g, tile.color.b }
+    };
+    file.write((const char*)&kind, sizeof(LevelFileTileKind));
+  }
+  file.write((const char*)tileMap.tiles, (size_t)tileMap.columns * tileMap.rows);
+  return file.good();
+}
+
+void addBrickToGrid(BrickGrid& brickGrid, unsigned int x, unsigned int y, unsigned int brick)
+{
+  // rows longer than the first one place bricks past the right edge of the level, they stay out of the grid
+  if (x < brickGrid.columns)
+  {
+    brickGrid.cells[y * brickGrid.columns + x] = brick;
+  }
+}
+
+// bricks are stored in row-major tile order, so the bricks of one row inside the region form a contiguous index range,
+// visit(first, last) is called once per row that has any
+template <typename Visitor>
+void forEachBrickRangeInRegion(BrickGrid& brickGrid, glm::vec2 topLeft, glm::vec2 bottomRight, Visitor visit)
+{
+  if (brickGrid.columns == 0 || brickGrid.rows == 0)
+  {
+    return;
+  }
+  // collision tests treat touching as overlapping, so a region starting exactly on a cell edge includes the cell before it
+  glm::vec2 minCell = glm::ceil(topLeft / brickGrid.cellSize) - 1.0f;
+  glm::vec2 maxCell = glm::floor(bottomRight / brickGrid.cellSize);
+  if (maxCell.x < 0.0f || maxCell.y < 0.0f || minCell.x >= brickGrid.columns || minCell.y >= brickGrid.rows)
+  {
+    return;
+  }
+  unsigned int minX = (unsigned int)std::max(minCell.x, 0.0f);
+  unsigned int minY = (unsigned int)std::max(minCell.y, 0.0f);
+  unsigned int maxX = (unsigned int)std::min(maxCell.x, (float)brickGrid.columns - 1);
+  unsigned int maxY = (unsigned int)std::min(maxCell.y, (float)brickGrid.rows - 1);
+  for (unsigned int y = minY; y <= maxY; y++)
+  {
+    int first = -1;
+    int last = -1;
+    for (unsigned int x = minX; x <= maxX; x++)
+    {
+      int brick = brickGrid.cells[y * brickGrid.columns + x];
+      if (brick >= 0)
+      {
+        first = first < 0 ? brick : first;
+        last = brick;
+      }
+    }
+    if (first >= 0)
+    {
+      visit((unsigned int)first, (unsigned int)last);
+    }
+  }
+}
+
+GameLevelMap createGameLevelMap(const GameLevelConfig& gameLevelConfig)
+{
+  const TileMap& tileMap = gameLevelConfig.tileMap;
+  GameLevelMap gameLevelMap =
+  {
+    .width = gameLevelConfig.width,
+    .height = gameLevelConfig.height,
+    .bricks = {},
+    .brickGrid = {},
+    .brickField = createBrickField(tileMap.brickCount),
+    .projection = glm::ortho(0.0f, (float)gameLevelConfig.width, (float)gameLevelConfig.height, 0.0f),
+    .destroyedBricks = {},
+    .restores = 0,
+  };
+  float blockWidth = gameLevelMap.width / (float)tileMap.columns;
+  float blockHeight = (gameLevelMap.height / 2.0f) / (float)tileMap.rows;
+  gameLevelMap.brickGrid = BrickGrid
+  { .columns = tileMap.columns,
+    .rows = tileMap.rows,
+    .cellSize = glm::vec2(blockWidth, blockHeight),
+    .cells = std::vector<int>((size_t)tileMap.columns * tileMap.rows, -1)
+  };
+  gameLevelMap.bricks.reserve(tileMap.brickCount);
+  for (unsigned int y = 0; y < tileMap.rows; y++)
+  {
+    const uint8_t* row = tileMap.tiles + (size_t)y * tileMap.columns;
+    for (unsigned int x = 0; x < tileMap.columns; x++)
+    {
+      const Tile& tile = tileMap.palette[row[x]];
+      if (tile.type == TILE_TYPE_EMPTY)
+      {
+        continue;
+      }
+      bool solid = tile.type == TILE_TYPE_SOLID;
+      GameObject brick;
+      brick.size = glm::vec2(blockWidth, blockHeight);
+      brick.position = brick.size * glm::vec2(x, y);
+      brick.rotation = 0.0f;
+      brick.color = tile.color;
+      brick.bodyType = solid ? GAME_OBJECT_BODY_SOLID : GAME_OBJECT_BODY_DESTROYABLE;
+      brick.status = GAME_OBJECT_ALIVE;
+      addBrickToGrid(gameLevelMap.brickGrid, x, y, gameLevelMap.bricks.size());
+      addBrickToField(gameLevelMap.brickField, brick.position, brick.position + brick.size);
+      gameLevelMap.bricks.push_back(brick);
+    }
+  }
+  return gameLevelMap;
+}
+
+BallObject loadBallObject(BallField& balls, unsigned int index)
+{
+  BallObject ball;
+  ball.position = balls.position[index];
+  ball.size = glm::vec2(balls.radius * 2.0f);
+  ball.rotation = 0.0f;
+  ball.color = balls.color;
+  ball.bodyType = GAME_OBJECT_BODY_SOLID;
+  ball.status = GAME_OBJECT_ALIVE;
+  ball.speed = balls.speed;
+  ball.radius = balls.radius;
+  ball.velocity = balls.velocity[index];
+  ball.previousPosition = balls.previousPosition[index];
+  ball.pathOrigin = balls.pathOrigin[index];
+  ball.pathTime = balls.pathTime[index];
+  ball.surfaceType = balls.surfaceType[index];
+  ball.collisionType = balls.collisionType[index];
+  return ball;
+}
+
+void storeBallObject(BallField& balls, unsigned int index, BallObject& ball)
+{
+  balls.position[index] = ball.position;
+  balls.velocity[index] = ball.velocity;
+  balls.previousPosition[index] = ball.previousPosition;
+  balls.pathOrigin[index] = ball.pathOrigin;
+  balls.pathTime[index] = ball.pathTime;
+  balls.surfaceType[index] = ball.surfaceType;
+  balls.collisionType[index] = ball.collisionType;
+}
+
+void addBallToField(BallField& balls, glm::vec2 position, glm::vec2 velocity, BallObjectSurfaceType surfaceType)
+{
+  unsigned int i = balls.count++;
+  balls.position[i] = position;
+  balls.previousPosition[i] = position;
+  balls.velocity[i] = velocity;
+  balls.pathOrigin[i] = position;
+  balls.pathTime[i] = 0.0f;
+  balls.surfaceType[i] = surfaceType;
+  balls.collisionType[i] = BALL_OBJECT_COLLISION_DEFAULT;
+}
+
+// the first ball waits on the paddle, the others are spread over the open lower half of the level by a low discrepancy
+// sequence and fly upwards in a fan, so the layout depends on nothing but the ball count
+BallField createBallField(GameLevelMap& gameLevelMap, const BallConfig& ballConfig, PlayerObject& playerObject)
+{
+  unsigned int capacity = std::max(1u, ballConfig.count);
+  BallField balls =
+  { .count = 0,
+    .speed = ballConfig.speed,
+    .radius = ballConfig.radius,
+    .color = ballConfig.color,
+    .position = std::vector<glm::vec2>(capacity),
+    .previousPosition = std::vector<glm::vec2>(capacity),
+    .velocity = std::vector<glm::vec2>(capacity),
+    .pathOrigin = std::vector<glm::vec2>(capacity),
+    .pathTime = std::vector<float>(capacity),
+    .surfaceType = std::vector<BallObjectSurfaceType>(capacity),
+    .collisionType = std::vector<BallObjectCollisionType>(capacity)
+  };
+  float diameter = ballConfig.radius * 2.0f;
+  addBallToField(balls, playerObject.position + glm::vec2(playerObject.size.x / 2.0f - ballConfig.radius, -diameter), glm::vec2(0.0f), BALL_OBJECT_SURFACE_STICKY);
+  glm::vec2 areaTopLeft = glm::vec2(0.0f, gameLevelMap.height / 2.0f);
+  glm::vec2 areaSize = glm::max(glm::vec2(gameLevelMap.width, playerObject.position.y - diameter) - areaTopLeft - diameter, glm::vec2(0.0f));
+  for (unsigned int i = 1; i < capacity; i++)
+  {
+    float u = std::fmod(i * 0.7548776662f, 1.0f);
+    float v = std::fmod(i * 0.5698402910f, 1.0f);
+    float angle = (std::fmod(i * 0.6180339887f, 1.0f) * 2.0f - 1.0f) * 1.2f;
+    glm::vec2 velocity = ballConfig.speed * glm::vec2(std::sin(angle), -std::cos(angle));
+    addBallToField(balls, areaTopLeft + glm::vec2(u, v) * areaSize, velocity, BALL_OBJECT_SURFACE_REFLECT);
+  }
+  return balls;
+}
+
+BallTrail createBallTrail(const BallConfig& ballConfig)
+{
+  return BallTrail
+  { .particles = createParticleField(ballConfig.particleCount),
+    .particleBackend = ballConfig.particleBackend,
+    .particleTime = 0.0f,
+    .spawnTimes = std::vector<float>(ballConfig.particleBackend == PARTICLE_BACKEND_GPU ? ballConfig.particleCount : 0, 0.0f),
+    .emitter = 0
+  };
+}
+
+PlayerObject createPlayerObject(GameLevelMap& gameLevelMap, const PlayerConfig& playerConfig)
+{
+  PlayerObject player;
+  player.velocity = playerConfig.velocity;
+  player.position = glm::vec2(std::max(gameLevelMap.width / 2.0f - playerConfig.size.x / 2.0f, 0.0f), gameLevelMap.height - playerConfig.size.y);
+  player.previousX = player.position.x;
+  player.size = playerConfig.size;
+  player.rotation = 0.0f;
+  player.color = playerConfig.color;
+  player.bodyType = GAME_OBJECT_BODY_SOLID;
+  player.status = GAME_OBJECT_ALIVE;
+  return player;
+}
+
+// copies the level's mutable state over the snapshot, the first save into a snapshot sizes its containers
+void saveGameLevel(GameLevel& gameLevel, GameLevelSnapshot& snapshot)
+{
+  snapshot.brickStatuses.resize(gameLevel.map.bricks.size());
+  for (unsigned int i = 0; i < gameLevel.map.bricks.size(); i++)
+  {
+    snapshot.brickStatuses[i] = gameLevel.map.bricks[i].status;
+  }
+  snapshot.player = gameLevel.player;
+  snapshot.balls = gameLevel.balls;
+  snapshot.trail = gameLevel.trail;
+  snapshot.screenEffects = gameLevel.screenEffects;
+  snapshot.shakeEffect = gameLevel.shakeEffect;
+  snapshot.powerUps = gameLevel.powerUps;
+  snapshot.powerUpEffects = gameLevel.powerUpEffects;
+  snapshot.powerUpRandom = gameLevel.powerUpRandom;
+  snapshot.particleRandom = gameLevel.particleRandom;
+}
+
+// the snapshot has to come from the same level, the brick field's alive lanes are rebuilt from the brick statuses
+void restoreGameLevel(GameLevel& gameLevel, GameLevelSnapshot& snapshot)
+{
+  for (unsigned int i = 0; i < gameLevel.map.bricks.size(); i++)
+  {
+    gameLevel.map.bricks[i].status = snapshot.brickStatuses[i];
+    gameLevel.map.brickField.alive[i] = snapshot.brickStatuses[i] == GAME_OBJECT_ALIVE ? 0xffffffff : 0;
+  }
+  gameLevel.map.destroyedBricks.clear();
+  gameLevel.map.restores++;
+  gameLevel.player = snapshot.player;
+  gameLevel.balls = snapshot.balls;
+  gameLevel.trail = snapshot.trail;
+  gameLevel.screenEffects = snapshot.screenEffects;
+  gameLevel.shakeEffect = snapshot.shakeEffect;
+  gameLevel.powerUps = snapshot.powerUps;
+  gameLevel.powerUpEffects = snapshot.powerUpEffects;
+  gameLevel.powerUpRandom = snapshot.powerUpRandom;
+  gameLevel.particleRandom = snapshot.particleRandom;
+}
+
+void hashGameLevelBytes(uint64_t& hash, const void* data, size_t size)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+}
+
+template <typename Value>
+void hashGameLevelValue(uint64_t& hash, const Value& value)
+{
+  hashGameLevelBytes(hash, &value, sizeof(Value));
+}
+
+void hashGameObject(uint64_t& hash, GameObject& gameObject)
+{
+  hashGameLevelValue(hash, gameObject.position);
+  hashGameLevelValue(hash, gameObject.size);
+  hashGameLevelValue(hash, gameObject.color);
+  hashGameLevelValue(hash, gameObject.status);
+}
+
+// fnv-1a over the gameplay state, two runs of a level that hash equally played out the same; the particle trail is
+// left out since it is cosmetic and the gpu backend empties it from the renderer
+uint64_t hashGameLevel(GameLevel& gameLevel)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (GameObject& brick : gameLevel.map.bricks)
+  {
+    hashGameLevelValue(hash, brick.status);
+  }
+  hashGameObject(hash, gameLevel.player);
+  hashGameLevelValue(hash, gameLevel.player.velocity);
+  BallField& balls = gameLevel.balls;
+  hashGameLevelValue(hash, balls.count);
+  hashGameLevelValue(hash, balls.color);
+  for (unsigned int i = 0; i < balls.count; i++)
+  {
+    hashGameLevelValue(hash, balls.position[i]);
+    hashGameLevelValue(hash, balls.velocity[i]);
+    hashGameLevelValue(hash, balls.pathOrigin[i]);
+    hashGameLevelValue(hash, balls.pathTime[i]);
+    hashGameLevelValue(hash, balls.surfaceType[i]);
+    hashGameLevelValue(hash, balls.collisionType[i]);
+  }
+  for (unsigned int i = 0; i < gameLevel.powerUps.count; i++)
+  {
+    PowerUpObject& powerUp = gameLevel.powerUps.items[i];
+    hashGameLevelValue(hash, powerUp.type);
+    hashGameLevelValue(hash, powerUp.position);
+  }
+  for (unsigned int i = 0; i < gameLevel.powerUpEffects.count; i++)
+  {
+    PowerUpEffect& powerUpEffect = gameLevel.powerUpEffects.items[i];
+    hashGameLevelValue(hash, powerUpEffect.type);
+    hashGameLevelValue(hash, powerUpEffect.ttl);
+    hashGameLevelValue(hash, powerUpEffect.status);
+  }
+  hashGameLevelValue(hash, gameLevel.screenEffects.confuse);
+  hashGameLevelValue(hash, gameLevel.screenEffects.chaos);
+  hashGameLevelValue(hash, gameLevel.shakeEffect.ttl);
+  hashGameLevelValue(hash, gameLevel.powerUpRandom);
+  return hash;
+}
+
+GameLevel createGameLevel(std::shared_ptr<const GameLevelConfig> sharedConfig)
+{
+  const GameLevelConfig& config = *sharedConfig;
+  GameLevelMap gameLevelMap = createGameLevelMap(config);
+  PlayerObject playerObject = createPlayerObject(gameLevelMap, config.playerConfig);
+  BallField balls = createBallField(gameLevelMap, config.ballConfig, playerObject);
+  ScreenEffects screenEffects = ScreenEffects { .confuse = false, .chaos = false, .shake = false };
+  ShakeEffect shakeEffect = ShakeEffect { .ttl = 0.0f };
+  // the map holds every brick of the level, it is moved rather than copied
+  GameLevel level =
+  { .config = sharedConfig,
+    .map = std::move(gameLevelMap),
+    .player = playerObject,
+    .balls = std::move(balls),
+    .trail = createBallTrail(config.ballConfig),
+    .brickHits = {},
+    .screenEffects = screenEffects,
+    .shakeEffect = shakeEffect,
+    .powerUps = createPool<PowerUpObject>(POWER_UP_POOL_CAPACITY),
+    .powerUpEffects = createPool<PowerUpEffect>(POWER_UP_POOL_CAPACITY),
+    .powerUpRandom = createRandomStream(config.seed, GAME_LEVEL_RANDOM_POWER_UPS),
+    .particleRandom = createRandomStream(config.seed, GAME_LEVEL_RANDOM_PARTICLES),
+    .initialState = {}
+  };
+  saveGameLevel(level, level.initialState);
+  return level;
+}
+
+template <typename Value>
+size_t measureVectorBytes(const std::vector<Value>& values)
+{
+  return values.capacity() * sizeof(Value);
+}
+
+size_t measureBallFieldBytes(BallField& balls)
+{
+  return measureVectorBytes(balls.position) + measureVectorBytes(balls.previousPosition) + measureVectorBytes(balls.velocity)
+    + measureVectorBytes(balls.pathOrigin) + measureVectorBytes(balls.pathTime) + measureVectorBytes(balls.surfaceType)
+    + measureVectorBytes(balls.collisionType);
+}
+
+size_t measureParticleFieldBytes(ParticleField& field)
+{
+  return measureVectorBytes(field.positionX) + measureVectorBytes(field.positionY) + measureVectorBytes(field.velocityX)
+    + measureVectorBytes(field.velocityY) + measureVectorBytes(field.red) + measureVectorBytes(field.green)
+    + measureVectorBytes(field.blue) + measureVectorBytes(field.alpha) + measureVectorBytes(field.life);
+}
+
+// heap and inline bytes the level owns; the config and the tiles behind it are shared and counted by
+// measureGameLevelConfigBytes instead
+size_t measureGameLevelBytes(GameLevel& gameLevel)
+{
+  BrickField& brickField = gameLevel.map.brickField;
+  GameLevelSnapshot& snapshot = gameLevel.initialState;
+  return sizeof(GameLevel)
+    + measureVectorBytes(gameLevel.map.bricks) + measureVectorBytes(gameLevel.map.brickGrid.cells)
+    + measureVectorBytes(brickField.minX) + measureVectorBytes(brickField.minY) + measureVectorBytes(brickField.maxX)
+    + measureVectorBytes(brickField.maxY) + measureVectorBytes(brickField.alive) + measureVectorBytes(gameLevel.map.destroyedBricks)
+    + measureBallFieldBytes(gameLevel.balls) + measureParticleFieldBytes(gameLevel.trail.particles)
+    + measureVectorBytes(gameLevel.trail.spawnTimes)
+    + measureVectorBytes(gameLevel.brickHits)
+    + measureVectorBytes(gameLevel.powerUps.items) + measureVectorBytes(gameLevel.powerUpEffects.items)
+    + measureVectorBytes(snapshot.brickStatuses) + measureBallFieldBytes(snapshot.balls)
+    + measureParticleFieldBytes(snapshot.trail.particles) + measureVectorBytes(snapshot.trail.spawnTimes)
+    + measureVectorBytes(snapshot.powerUps.items) + measureVectorBytes(snapshot.powerUpEffects.items);
+}
+
+size_t measureGameLevelConfigBytes(const GameLevelConfig& config)
+{
+  return sizeof(GameLevelConfig) + measureVectorBytes(config.tileMap.palette) + (size_t)config.tileMap.columns * config.tileMap.rows;
+}
+
+// called whenever the ball is moved or redirected other than along its path
+void startBallObjectPath(BallObject& ballObject)
+{
+  ballObject.pathOrigin = ballObject.position;
+  ballObject.pathTime = 0.0f;
+}
+
+AabbCollisionBox gameObjectToAabbCollisionBox(GameObject& gameObject)
+{
+  return AabbCollisionBox
+  { .topLeft = gameObject.position,
+    .bottomRight = gameObject.position + gameObject.size
+  };
+}
+
+AabbCollisionCircle ballObjectToAabbCollisionCircle(BallObject& ballObject)
+{
+  return AabbCollisionCircle
+  { .radius = ballObject.radius,
+    .center = ballObject.position + glm::vec2(ballObject.radius)
+  };
+}
+
+// returns false when the trail is full; a full trail skips the random draws too, the trail has a stream of its own, so
+// the backend emptying the field at a different rate never changes what the rest of the game draws
+bool spawnBallParticle(ParticleField& particles, BallField& balls, unsigned int ball, RandomStream& random)
+{
+  if (particles.count == particles.capacity)
+  {
+    return false;
+  }
+  glm::vec2 offset = glm::vec2(balls.radius / 2.0f);
+  float jitter = ((int)nextRandomBelow(random, 100) - 50) / 10.0f;
+  float rColor = 0.5f + (nextRandomBelow(random, 100) / 100.0f);
+  spawnParticle(particles, balls.position[ball] + jitter + offset, balls.velocity[ball] * 0.1f, glm::vec4(rColor, rColor, rColor, 1.0f), 1.0f);
+  return true;
+}
+
+// every ball emits two particles a step for as long as the shared trail has room
+void handleBallObjectParticles(UpdateState& updateState, GameLevel& gameLevel)
+{
+  BallField& balls = gameLevel.balls;
+  BallTrail& trail = gameLevel.trail;
+  unsigned int queued = trail.particles.count;
+  bool room = true;
+  for (unsigned int i = 0; i < balls.count && room; i++)
+  {
+    unsigned int ball = (trail.emitter + i) % balls.count;
+    room = spawnBallParticle(trail.particles, balls, ball, gameLevel.particleRandom)
+      && spawnBallParticle(trail.particles, balls, ball, gameLevel.particleRandom);
+  }
+  trail.emitter = balls.count > 0 ? (trail.emitter + 1) % balls.count : 0;
+  if (trail.particleBackend == PARTICLE_BACKEND_GPU)
+  {
+    std::fill(trail.spawnTimes.begin() + queued, trail.spawnTimes.begin() + trail.particles.count, trail.particleTime);
+    trail.particleTime += updateState.deltaTime;
+    return;
+  }
+  updateParticles(trail.particles, updateState.deltaTime, updateState.deltaTime * BALL_PARTICLE_FADE_RATE);
+}
+
+// picks the axis direction with the largest projection, checked in the order up, right, down, left with ties
+// going to the earlier one; scaling by a positive length does not change the winner, so the target is not normalized
+Direction directionFromTarget(glm::vec2 target)
+{
+  float max = 0.0f;
+  Direction bestMatch = DIRECTION_UP;
+  max = target.y > max ? target.y : max;
+  bestMatch = target.x > max ? DIRECTION_RIGHT : bestMatch;
+  max = target.x > max ? target.x : max;
+  bestMatch = -target.y > max ? DIRECTION_DOWN : bestMatch;
+  max = -target.y > max ? -target.y : max;
+  bestMatch = -target.x > max ? DIRECTION_LEFT : bestMatch;
+  return bestMatch;
+}
+
+std::optional<Collision> checkCircleToBoxCollision(AabbCollisionCircle circle, AabbCollisionBox box)
+{
+  glm::vec2 halfExtent = (box.bottomRight - box.topLeft) / 2.0f;
+  glm::vec2 center = box.topLeft + halfExtent;
+  glm::vec2 closest = center + glm::clamp(circle.center - center, -halfExtent, halfExtent);
+  glm::vec2 difference = closest - circle.center;
+  if (glm::length(difference) > circle.radius)
+  {
+    return {};
+  }
+  return Collision
+  { .direction = directionFromTarget(difference),
+    .difference = difference
+  };
+}
+
+std::optional<Collision> checkBoxToBoxCollision(AabbCollisionBox boxA, AabbCollisionBox boxB)
+{
+  bool collisionX = boxB.topLeft.x <= boxA.bottomRight.x && boxA.topLeft.x <= boxB.bottomRight.x;
+  bool collisionY = boxB.topLeft.y <= boxA.bottomRight.y && boxA.topLeft.y <= boxB.bottomRight.y;
+  if (collisionX && collisionY)
+  {
+    glm::vec2 difference = glm::vec2((boxA.topLeft + boxA.bottomRight) - (boxB.topLeft + boxB.bottomRight));
+    return Collision
+    { .direction = directionFromTarget(difference),
+      .difference = difference
+    };
+  }
+  return {};
+}
+
+// a circle left touching a box by an earlier contact can end up this far off it through rounding and still counts as touching
+const float SWEPT_COLLISION_SLOP = 0.001f;
+
+// the circle moves at velocity for duration, the time of impact is in the same unit as duration;
+// the circle's center sweeps the box grown by the radius, whose corners are rounded: the slab test finds where the
+// center enters the grown box, and an entry beyond the box on both axes lies in a rounded corner so it is redone against
+// the circle around that corner; a circle already touching the box collides only while it still moves further in
+std::optional<SweptCollision> sweepCircleToBox(AabbCollisionCircle circle, glm::vec2 velocity, float duration, AabbCollisionBox box)
+{
+  if (velocity == glm::vec2(0.0f))
+  {
+    return {};
+  }
+  glm::vec2 halfExtent = (box.bottomRight - box.topLeft) / 2.0f;
+  glm::vec2 center = box.topLeft + halfExtent;
+  glm::vec2 offset = circle.center - center;
+  glm::vec2 difference = circle.center - (center + glm::clamp(offset, -halfExtent, halfExtent));
+  float distance = glm::length(difference);
+  if (!(distance > circle.radius + SWEPT_COLLISION_SLOP))
+  {
+    glm::vec2 normal = difference / distance;
+    if (distance == 0.0f)
+    {
+      // the center is inside the box, it leaves through the nearest face
+      glm::vec2 depth = halfExtent - glm::abs(offset);
+      normal = depth.x < depth.y ? glm::vec2(offset.x < 0.0f ? -1.0f : 1.0f, 0.0f) : glm::vec2(0.0f, offset.y < 0.0f ? -1.0f : 1.0f);
+    }
+    if (glm::dot(velocity, normal) >= 0.0f)
+    {
+      return {};
+    }
+    return SweptCollision
+    { .time = 0.0f,
+      .normal = normal
+    };
+  }
+  glm::vec2 grownTopLeft = box.topLeft - circle.radius;
+  glm::vec2 grownBottomRight = box.bottomRight + circle.radius;
+  float entry = -INFINITY;
+  float exit = INFINITY;
+  unsigned int axis = 0;
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    if (velocity[i] == 0.0f)
+    {
+      if (circle.center[i] < grownTopLeft[i] || circle.center[i] > grownBottomRight[i])
+      {
+        return {};
+      }
+      continue;
+    }
+    float near = (grownTopLeft[i] - circle.center[i]) / velocity[i];
+    float far = (grownBottomRight[i] - circle.center[i]) / velocity[i];
+    if (near > far)
+    {
+      std::swap(near, far);
+    }
+    if (near > entry)
+    {
+      entry = near;
+      axis = i;
+    }
+    exit = std::min(exit, far);
+  }
+  if (entry > exit || entry > duration || exit < 0.0f)
+  {
+    return {};
+  }
+  entry = std::max(entry, 0.0f);
+  glm::vec2 point = circle.center + velocity * entry;
+  bool outsideX = point.x < box.topLeft.x || point.x > box.bottomRight.x;
+  bool outsideY = point.y < box.topLeft.y || point.y > box.bottomRight.y;
+  if (outsideX && outsideY)
+  {
+    glm::vec2 corner = glm::vec2(
+      point.x < box.topLeft.x ? box.topLeft.x : box.bottomRight.x,
+      point.y < box.topLeft.y ? box.topLeft.y : box.bottomRight.y
+    );
+    glm::vec2 fromCorner = circle.center - corner;
+    float a = glm::dot(velocity, velocity);
+    float b = glm::dot(fromCorner, velocity);
+    float c = glm::dot(fromCorner, fromCorner) - circle.radius * circle.radius;
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f)
+    {
+      return {};
+    }
+    float time = (-b - std::sqrt(discriminant)) / a;
+    if (time < 0.0f || time > duration)
+    {
+      return {};
+    }
+    return SweptCollision
+    { .time = time,
+      .normal = (fromCorner + velocity * time) / circle.radius
+    };
+  }
+  glm::vec2 normal = glm::vec2(0.0f);
+  normal[axis] = velocity[axis] > 0.0f ? -1.0f : 1.0f;
+  return SweptCollision
+  { .time = entry,
+    .normal = normal
+  };
+}
+
+void spawnPowerUp(const PowerUpConfig& config, glm::vec2 position, UpdateState& updateState, GameLevel& gameLevel)
+{
+  if (config.chance != 0 && nextRandomBelow(gameLevel.powerUpRandom, config.chance) == 0)
+  {
+    addPoolItem(gameLevel.powerUps, createPowerUp(config, position));
+  }
+}
+
+void spawnPowerUps(glm::vec2 position, UpdateState& updateState, GameLevel& gameLevel)
+{
+  for (const PowerUpConfig& config : gameLevel.config->powerUpConfigs)
+  {
+    spawnPowerUp(config, position, updateState, gameLevel);
+  }
+}
+
+void activatePowerUp(PowerUpEffect& powerUp, UpdateState& updateState, GameLevel& gameLevel)
+{
+  switch (powerUp.type)
+  {
+    case POWER_UP_SPEED:
+    {
+      gameLevel.player.velocity *= 1.2f;
+      break;
+    }
+    case POWER_UP_STICKY:
+    {
+      std::fill_n(gameLevel.balls.surfaceType.begin(), gameLevel.balls.count, BALL_OBJECT_SURFACE_STICKY);
+      gameLevel.balls.color = glm::vec3(1.0f, 0.5f, 1.0f);
+      break;
+    }
+    case POWER_UP_PASS_THROUGH:
+    {
+      std::fill_n(gameLevel.balls.collisionType.begin(), gameLevel.balls.count, BALL_OBJECT_COLLISION_PASS_THROUGH);
+      gameLevel.balls.color = glm::vec3(1.0f, 0.5f, 0.5f);
+      break;
+    }
+    case POWER_UP_PADDLE_SIZE_UP:
+    {
+      gameLevel.player.size.x += 50.0f;
+      break;
+    }
+    case POWER_UP_CONFUSION:
+    {
+      gameLevel.screenEffects.confuse = true;
+      break;
+    }
+    case POWER_UP_CHAOS:
+    {
+      gameLevel.screenEffects.chaos = true;
+      break;
+    }
+  }
+}
+
+void deactivatePowerUp(PowerUpEffect& powerUp, UpdateState& updateState, GameLevel& gameLevel)
+{
+  switch (powerUp.type)
+  {
+    case POWER_UP_SPEED:
+    {
+      gameLevel.player.velocity = gameLevel.config->playerConfig.velocity;
+      break;
+    }
+    case POWER_UP_STICKY:
+    {
+      std::fill_n(gameLevel.balls.surfaceType.begin(), gameLevel.balls.count, BALL_OBJECT_SURFACE_REFLECT);
+      gameLevel.balls.color = gameLevel.config->ballConfig.color;
+      break;
+    }
+    case POWER_UP_PASS_THROUGH:
+    {
+      std::fill_n(gameLevel.balls.collisionType.begin(), gameLevel.balls.count, BALL_OBJECT_COLLISION_DEFAULT);
+      gameLevel.balls.color = gameLevel.config->ballConfig.color;
+      break;
+    }
+    case POWER_UP_PADDLE_SIZE_UP:
+    {
+      gameLevel.player.size = gameLevel.config->playerConfig.size;
+      break;
+    }
+    case POWER_UP_CONFUSION:
+    {
+      gameLevel.screenEffects.confuse = false;
+      break;
+    }
+    case POWER_UP_CHAOS:
+    {
+      gameLevel.screenEffects.chaos = false;
+      break;
+    }
+  }
+}
+
+BallSweep createBallSweep(float speed)
+{
+  return BallSweep
+  { .time = INFINITY,
+    .tolerance = BALL_CONTACT_TOLERANCE / speed,
+    .count = 0,
+    .contacts = {}
+  };
+}
+
+// keeps every contact within the tolerance of the earliest one, whatever order they are found in
+void addBallContact(BallSweep& sweep, BallContact contact)
+{
+  if (contact.time > sweep.time + sweep.tolerance)
+  {
+    return;
+  }
+  if (contact.time < sweep.time)
+  {
+    sweep.time = contact.time;
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < sweep.count; i++)
+    {
+      if (sweep.contacts[i].time <= sweep.time + sweep.tolerance)
+      {
+        sweep.contacts[kept++] = sweep.contacts[i];
+      }
+    }
+    sweep.count = kept;
+  }
+  if (sweep.count < BALL_SWEEP_MAX_CONTACTS)
+  {
+    sweep.contacts[sweep.count++] = contact;
+  }
+}
+
+void addBallWallContact(BallSweep& sweep, float time, float duration, BallContactType type, glm::vec2 normal)
+{
+  if (time > duration)
+  {
+    return;
+  }
+  addBallContact(sweep, BallContact { .type = type, .brick = 0, .time = std::max(time, 0.0f), .normal = normal });
+}
+
+// the walls are lines the edge of the ball may touch but not cross, reaching the floor takes the ball out of play
+void sweepBallObjectWalls(GameLevel& gameLevel, BallObject& ball, float duration, BallSweep& sweep)
+{
+  glm::vec2 origin = ball.pathOrigin;
+  glm::vec2 velocity = ball.velocity;
+  glm::vec2 farthest = glm::vec2(gameLevel.map.width, gameLevel.map.height) - ball.size;
+  if (velocity.x < 0.0f)
+  {
+    addBallWallContact(sweep, -origin.x / velocity.x, duration, BALL_CONTACT_WALL, glm::vec2(1.0f, 0.0f));
+  }
+  else if (velocity.x > 0.0f)
+  {
+    addBallWallContact(sweep, (farthest.x - origin.x) / velocity.x, duration, BALL_CONTACT_WALL, glm::vec2(-1.0f, 0.0f));
+  }
+  if (velocity.y < 0.0f)
+  {
+    addBallWallContact(sweep, -origin.y / velocity.y, duration, BALL_CONTACT_WALL, glm::vec2(0.0f, 1.0f));
+  }
+  else if (velocity.y > 0.0f)
+  {
+    addBallWallContact(sweep, (farthest.y - origin.y) / velocity.y, duration, BALL_CONTACT_FLOOR, glm::vec2(0.0f, -1.0f));
+  }
+}
+
+// bricks stay as they were at the start of the step until every ball has moved, the hits from firstOwnHit on are this
+// ball's and the destroyable bricks among them are skipped, as if the ball had already knocked them out
+void sweepBallObjectBricks(GameLevel& gameLevel, BallObject& ball, unsigned int firstOwnHit, float duration, BallSweep& sweep)
+{
+  AabbCollisionCircle circle = { .radius = ball.radius, .center = ball.pathOrigin + glm::vec2(ball.radius) };
+  // a brick hit in this stretch lies in the cells between where the ball is now and where the stretch ends, and touches
+  // the circle enclosing that part of the path; both are padded so rounding cannot change which bricks are tested
+  glm::vec2 end = ball.pathOrigin + duration * ball.velocity;
+  glm::vec2 padding = glm::vec2(SWEPT_COLLISION_SLOP + BALL_CONTACT_TOLERANCE);
+  glm::vec2 sweptTopLeft = glm::min(ball.position, end) - padding;
+  glm::vec2 sweptBottomRight = glm::max(ball.position, end) + ball.size + padding;
+  glm::vec2 middle = (ball.position + end) / 2.0f + glm::vec2(ball.radius);
+  float reach = ball.radius + glm::length(end - ball.position) / 2.0f + padding.x;
+  forEachBrickRangeInRegion(gameLevel.map.brickGrid, sweptTopLeft, sweptBottomRight, [&](unsigned int first, unsigned int last)
+  {
+    forEachBrickHit(gameLevel.map.brickField, first, last, middle.x, middle.y, reach, [&](unsigned int index)
+    {
+      GameObject& brick = gameLevel.map.bricks[index];
+      if (brick.bodyType == GAME_OBJECT_BODY_SOLID && ball.collisionType == BALL_OBJECT_COLLISION_PASS_THROUGH)
+      {
+        return;
+      }
+      for (unsigned int i = firstOwnHit; i < gameLevel.brickHits.size() && brick.bodyType == GAME_OBJECT_BODY_DESTROYABLE; i++)
+      {
+        if (gameLevel.brickHits[i].brick == index)
+        {
+          return;
+        }
+      }
+      std::optional<SweptCollision> result = sweepCircleToBox(circle, ball.velocity, duration, gameObjectToAabbCollisionBox(brick));
+      if (result.has_value())
+      {
+        addBallContact(sweep, BallContact { .type = BALL_CONTACT_BRICK, .brick = index, .time = result.value().time, .normal = result.value().normal });
+      }
+    });
+  });
+}
+
+// the paddle is swept as if it stood still since the path started, unless the hit would lie behind the ball,
+// in which case the paddle has moved into the path and it is swept from where the ball is now
+void sweepBallObjectPlayer(GameLevel& gameLevel, BallObject& ball, float duration, BallSweep& sweep)
+{
+  AabbCollisionBox box = gameObjectToAabbCollisionBox(gameLevel.player);
+  AabbCollisionCircle circle = { .radius = ball.radius, .center = ball.pathOrigin + glm::vec2(ball.radius) };
+  std::optional<SweptCollision> result = sweepCircleToBox(circle, ball.velocity, duration, box);
+  if (result.has_value() && result.value().time < ball.pathTime)
+  {
+    circle.center = ball.position + glm::vec2(ball.radius);
+    result = sweepCircleToBox(circle, ball.velocity, duration - ball.pathTime, box);
+    if (result.has_value())
+    {
+      result.value().time += ball.pathTime;
+    }
+  }
+  if (result.has_value())
+  {
+    addBallContact(sweep, BallContact { .type = BALL_CONTACT_PLAYER, .brick = 0, .time = result.value().time, .normal = result.value().normal });
+  }
+}
+
+// contacts up to a little past endTime are gathered so that ones resolved together do not depend on where steps end
+BallSweep sweepBallObject(GameLevel& gameLevel, BallObject& ball, unsigned int firstOwnHit, float endTime)
+{
+  BallSweep sweep = createBallSweep(glm::length(ball.velocity));
+  float duration = endTime + sweep.tolerance;
+  sweepBallObjectWalls(gameLevel, ball, duration, sweep);
+  sweepBallObjectBricks(gameLevel, ball, firstOwnHit, duration, sweep);
+  sweepBallObjectPlayer(gameLevel, ball, duration, sweep);
+  return sweep;
+}
+
+// the axis whose velocity carries the ball furthest into the contact is reversed, on a face that is the face's own axis
+unsigned int ballReflectionAxis(glm::vec2 velocity, glm::vec2 normal)
+{
+  glm::vec2 approach = velocity * normal;
+  return approach.x < approach.y ? 0 : 1;
+}
+
+void bounceBallObjectOffPlayer(GameLevel& gameLevel, BallObject& ball, Direction direction)
+{
+  if (direction == DIRECTION_UP)
+  {
+    ball.position.y = gameLevel.player.position.y - ball.size.y;
+  }
+  else if (direction == DIRECTION_DOWN)
+  {
+    ball.position.y = gameLevel.player.position.y + gameLevel.player.size.y;
+  }
+  else if (direction == DIRECTION_LEFT)
+  {
+    ball.position.x = gameLevel.player.position.x - ball.size.x;
+  }
+  else if (direction == DIRECTION_RIGHT)
+  {
+    ball.position.x = gameLevel.player.position.x + gameLevel.player.size.x;
+  }
+  if (ball.surfaceType == BALL_OBJECT_SURFACE_STICKY)
+  {
+    ball.velocity = glm::vec2(0.0f);
+  }
+  else
+  {
+    glm::vec2 half = gameLevel.player.size / 2.0f;
+    glm::vec2 center = gameLevel.player.position + half;
+    float distance = (ball.position.x + ball.radius) - center.x;
+    float percentage = distance / half.x;
+    float strength = 2.0f;
+    glm::vec2 velocity = ball.velocity;
+    ball.velocity.x = ball.speed * percentage * strength;
+    ball.velocity = glm::normalize(ball.velocity) * glm::length(velocity);
+    ball.velocity.y = -1.0f * std::abs(ball.velocity.y);
+  }
+}
+
+// every contact in the sweep happened at the same moment, so each axis is reversed at most once for all of them; the ball
+// bounces off every brick it reached, what happens to the bricks is left to resolveBrickHits
+void resolveBallContacts(GameLevel& gameLevel, BallObject& ball, unsigned int ballIndex, float time, unsigned int firstOwnHit, BallSweep& sweep)
+{
+  bool reflect[2] = { false, false };
+  std::optional<glm::vec2> playerNormal = {};
+  for (unsigned int i = 0; i < sweep.count; i++)
+  {
+    BallContact& contact = sweep.contacts[i];
+    if (contact.type == BALL_CONTACT_PLAYER)
+    {
+      playerNormal = contact.normal;
+      continue;
+    }
+    if (contact.type == BALL_CONTACT_BRICK)
+    {
+      gameLevel.brickHits.push_back(BallBrickHit
+      { .time = time,
+        .ball = ballIndex,
+        .order = (unsigned int)gameLevel.brickHits.size() - firstOwnHit,
+        .brick = contact.brick
+      });
+    }
+    reflect[ballReflectionAxis(ball.velocity, contact.normal)] = true;
+  }
+  for (unsigned int axis = 0; axis < 2; axis++)
+  {
+    if (reflect[axis])
+    {
+      ball.velocity[axis] *= -1.0f;
+    }
+  }
+  if (playerNormal.has_value())
+  {
+    bounceBallObjectOffPlayer(gameLevel, ball, directionFromTarget(-playerNormal.value()));
+  }
+}
+
+// the ball moves to its earliest contact, resolves it and carries on with the time left, so it cannot pass through
+// anything however far it travels in one step; contact times are solved from the start of the path rather than from
+// the start of the step, so the ball hits the same things at the same moments whatever the timestep. returns false
+// once the ball reaches the floor
+bool moveBallObject(UpdateState& updateState, GameLevel& gameLevel, BallObject& ball, unsigned int ballIndex)
+{
+  unsigned int firstOwnHit = gameLevel.brickHits.size();
+  float remaining = updateState.deltaTime;
+  for (unsigned int i = 0; i < BALL_OBJECT_MAX_SWEEPS && remaining > 0.0f; i++)
+  {
+    if (ball.velocity == glm::vec2(0.0f))
+    {
+      return true;
+    }
+    float endTime = ball.pathTime + remaining;
+    BallSweep sweep = sweepBallObject(gameLevel, ball, firstOwnHit, endTime);
+    if (sweep.time > endTime)
+    {
+      ball.pathTime = endTime;
+      ball.position = ball.pathOrigin + endTime * ball.velocity;
+      return true;
+    }
+    remaining = std::max(endTime - sweep.time, 0.0f);
+    ball.position = ball.pathOrigin + sweep.time * ball.velocity;
+    for (unsigned int j = 0; j < sweep.count && !gameLevel.config->ballConfig.floorReflects; j++)
+    {
+      if (sweep.contacts[j].type == BALL_CONTACT_FLOOR)
+      {
+        return false;
+      }
+    }
+    resolveBallContacts(gameLevel, ball, ballIndex, updateState.deltaTime - remaining, firstOwnHit, sweep);
+    startBallObjectPath(ball);
+  }
+  return true;
+}
+
+// hits are applied in the order they happened, ties broken by ball and then by the order within the ball, so the result
+// does not depend on the order the balls were moved in; a brick several balls reached is destroyed by the first of them
+// and drops its power ups once, every one of those balls has already bounced off it
+void resolveBrickHits(UpdateState& updateState, GameLevel& gameLevel)
+{
+  std::sort(gameLevel.brickHits.begin(), gameLevel.brickHits.end(), [](const BallBrickHit& a, const BallBrickHit& b)
+  {
+    return std::tie(a.time, a.ball, a.order) < std::tie(b.time, b.ball, b.order);
+  });
+  for (BallBrickHit& hit : gameLevel.brickHits)
+  {
+    GameObject& brick = gameLevel.map.bricks[hit.brick];
+    if (brick.bodyType == GAME_OBJECT_BODY_SOLID)
+    {
+      gameLevel.shakeEffect.ttl = gameLevel.config->shakeEffectConfig.duration;
+    }
+    else if (brick.status == GAME_OBJECT_ALIVE)
+    {
+      brick.status = GAME_OBJECT_DESTROYED;
+      gameLevel.map.brickField.alive[hit.brick] = 0;
+      gameLevel.map.destroyedBricks.push_back(hit.brick);
+      spawnPowerUps(brick.position, updateState, gameLevel);
+    }
+  }
+  gameLevel.brickHits.clear();
+}
+
+// every ball moves through the same brick field in one pass, then the bricks they hit are resolved together; the level
+// is over once the last ball is lost
+void handleBallObjectMovement(UpdateState& updateState, GameLevel& gameLevel)
+{
+  BallField& balls = gameLevel.balls;
+  gameLevel.brickHits.clear();
+  unsigned int kept = 0;
+  for (unsigned int i = 0; i < balls.count; i++)
+  {
+    BallObject ball = loadBallObject(balls, i);
+    if (moveBallObject(updateState, gameLevel, ball, i))
+    {
+      storeBallObject(balls, kept++, ball);
+    }
+  }
+  balls.count = kept;
+  resolveBrickHits(updateState, gameLevel);
+  if (balls.count == 0)
+  {
+    // game over
+    restoreGameLevel(gameLevel, gameLevel.initialState);
+  }
+}
+
+bool isBallOnPlayer(GameLevel& gameLevel, unsigned int ball)
+{
+  BallField& balls = gameLevel.balls;
+  AabbCollisionCircle circle = { .radius = balls.radius, .center = balls.position[ball] + glm::vec2(balls.radius) };
+  return checkCircleToBoxCollision(circle, gameObjectToAabbCollisionBox(gameLevel.player)).has_value();
+}
+
+void startBallPath(BallField& balls, unsigned int ball)
+{
+  balls.pathOrigin[ball] = balls.position[ball];
+  balls.pathTime[ball] = 0.0f;
+}
+
+// balls stuck to the paddle move with it
+void movePlayerObject(UpdateState& updateState, GameLevel& gameLevel, float travel)
+{
+  float x = gameLevel.player.position.x;
+  float maxX = std::max(0.0f, (float)gameLevel.map.width - gameLevel.player.size.x);
+  gameLevel.player.position.x += travel;
+  gameLevel.player.position.x = std::clamp(gameLevel.player.position.x, 0.0f, maxX);
+  float xdiff = gameLevel.player.position.x - x;
+  BallField& balls = gameLevel.balls;
+  for (unsigned int i = 0; i < balls.count; i++)
+  {
+    if (balls.surfaceType[i] == BALL_OBJECT_SURFACE_STICKY && isBallOnPlayer(gameLevel, i))
+    {
+      balls.position[i].x += xdiff;
+      startBallPath(balls, i);
+    }
+  }
+}
+
+void handlePlayerInput(UpdateState& updateState, GameLevel& gameLevel)
+{
+  float travel = gameLevel.player.velocity * updateState.deltaTime;
+  if (updateState.input.left)
+  {
+    movePlayerObject(updateState, gameLevel, travel * -1);
+  }
+  if (updateState.input.right)
+  {
+    movePlayerObject(updateState, gameLevel, travel);
+  }
+  if (updateState.input.launch)
+  {
+    BallField& balls = gameLevel.balls;
+    for (unsigned int i = 0; i < balls.count; i++)
+    {
+      if (balls.surfaceType[i] == BALL_OBJECT_SURFACE_STICKY && isBallOnPlayer(gameLevel, i))
+      {
+        balls.surfaceType[i] = BALL_OBJECT_SURFACE_REFLECT;
+        balls.velocity[i] = balls.speed * glm::normalize(glm::vec2(1.0f, -1.0f));
+        startBallPath(balls, i);
+      }
+    }
+  }
+}
+
+AabbCollisionBox powerUpToAabbCollisionBox(PowerUpObject& powerUp)
+{
+  return AabbCollisionBox
+  { .topLeft = powerUp.position,
+    .bottomRight = powerUp.position + powerUp.size
+  };
+}
+
+void handleUpdatePowerUpObject(UpdateState& updateState, GameLevel& gameLevel)
+{
+  AabbCollisionBox playerCollisionBox = gameObjectToAabbCollisionBox(gameLevel.player);
+  Pool<PowerUpObject>& powerUps = gameLevel.powerUps;
+  for (unsigned int i = 0; i < powerUps.count;)
+  {
+    PowerUpObject& powerUp = powerUps.items[i];
+    powerUp.position += updateState.deltaTime * powerUp.velocity;
+    if (powerUp.position.y + powerUp.size.y >= gameLevel.map.height)
+    {
+      // the last live power up moves into this slot and is updated next
+      removePoolItem(powerUps, i);
+      continue;
+    }
+    std::optional<Collision> result = checkBoxToBoxCollision(
+      powerUpToAabbCollisionBox(powerUp),
+      playerCollisionBox
+    );
+    if (result.has_value())
+    {
+      addPoolItem(gameLevel.powerUpEffects, createPowerUpEffect(gameLevel.config->powerUpConfigs[powerUp.type]));
+      removePoolItem(powerUps, i);
+      continue;
+    }
+    i++;
+  }
+}
+
+void handleUpdatePowerUpEffect(UpdateState& updateState, GameLevel& gameLevel)
+{
+  Pool<PowerUpEffect>& powerUpEffects = gameLevel.powerUpEffects;
+  for (unsigned int i = 0; i < powerUpEffects.count;)
+  {
+    PowerUpEffect& powerUpEffect = powerUpEffects.items[i];
+    if (powerUpEffect.status == POWER_UP_EFFECT_STATUS_DEACTIVATED)
+    {
+      removePoolItem(powerUpEffects, i);
+      continue;
+    }
+    powerUpEffect.ttl = std::max(powerUpEffect.ttl - updateState.deltaTime, 0.0f);
+    if (powerUpEffect.status == POWER_UP_EFFECT_STATUS_ACTIVATED && powerUpEffect.ttl <= 0)
+    {
+      powerUpEffect.status = POWER_UP_EFFECT_STATUS_DEACTIVATE;
+    }
+    else if (powerUpEffect.status == POWER_UP_EFFECT_STATUS_ACTIVATE)
+    {
+      activatePowerUp(powerUpEffect, updateState, gameLevel);
+      powerUpEffect.status = POWER_UP_EFFECT_STATUS_ACTIVATED;
+    }
+    else if (powerUpEffect.status == POWER_UP_EFFECT_STATUS_DEACTIVATE)
+    {
+      deactivatePowerUp(powerUpEffect, updateState, gameLevel);
+      powerUpEffect.status = POWER_UP_EFFECT_STATUS_DEACTIVATED;
+    }
+    i++;
+  }
+}
+
+void handleShakeEffect(UpdateState& updateState, GameLevel& gameLevel)
+{
+  gameLevel.screenEffects.shake = gameLevel.shakeEffect.ttl > 0.0f;
+  gameLevel.shakeEffect.ttl = std::max(gameLevel.shakeEffect.ttl - updateState.deltaTime, 0.0f);
+}
+
+// taken before anything moves, so a ball carried by the paddle is rendered moving with it
+void storePreviousPositions(GameLevel& gameLevel)
+{
+  gameLevel.player.previousX = gameLevel.player.position.x;
+  BallField& balls = gameLevel.balls;
+  std::copy_n(balls.position.begin(), balls.count, balls.previousPosition.begin());
+}
+
+void updateGameLevel(UpdateState& updateState, GameLevel& gameLevel)
+{
+  storePreviousPositions(gameLevel);
+  handlePlayerInput(updateState, gameLevel);
+  handleBallObjectMovement(updateState, gameLevel);
+  handleBallObjectParticles(updateState, gameLevel);
+  handleUpdatePowerUpObject(updateState, gameLevel);
+  handleUpdatePowerUpEffect(updateState, gameLevel);
+  handleShakeEffect(updateState, gameLevel);
+}
+
+// every destroyable brick is gone, solid ones never are
+bool isGameLevelCompleted(GameLevel& gameLevel)
+{
+  for (GameObject& brick : gameLevel.map.bricks)
+  {
+    if (brick.bodyType == GAME_OBJECT_BODY_DESTROYABLE && brick.status == GAME_OBJECT_ALIVE)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void updateGameState(UpdateState& updateState, GameState& gameState)
+{
+  if (gameState.status == GAME_ACTIVE)
+  {
+    updateGameLevel(updateState, gameState.gameLevel);
+  }
+}
+
+// gameplay tuning shared by the windowed game and the headless simulation, render resources are attached by the caller
+GameLevelConfig createGameLevelConfig(TileMap tileMap, unsigned int width, unsigned int height)
+{
+  PlayerConfig playerConfig =
+  {
+    .velocity = 500.0f,
+    .size = glm::vec2(100.0f, 20.0f),
+    .color = glm::vec3(1.0f),
+    .sprite = 0
+  };
+  BallConfig ballConfig =
+  {
+    .speed = 400.0f,
+    .radius = 12.5f,
+    .color = glm::vec3(1.0f),
+    .sprite = 0,
+    .count = 1,
+    .floorReflects = false,
+    .particleCount = BALL_PARTICLE_COUNT,
+    .particleBackend = PARTICLE_BACKEND_CPU,
+    .particleModel = 0
+  };
+  ShakeEffectConfig shakeEffectConfig =
+  {
+    .duration = 0.05f,
+  };
+  // in PowerUpType order, the table is indexed by type
+  std::array<PowerUpConfig, POWER_UP_TYPE_COUNT> powerUpConfigs =
+  {
+    PowerUpConfig
+    {
+      .type = POWER_UP_SPEED,
+      .chance = 2,
+      .ttl = 10.0f,
+      .sprite = 0,
+      .velocity = glm::vec2(0.0f, 120.0f),
+      .size = glm::vec2(20.f),
+      .color = glm::vec3(1.0f),
+    },
+    PowerUpConfig
+    {
+      .type = POWER_UP_STICKY,
+      .chance = 2,
+      .ttl = 10.0f,
+      .sprite = 0,
+      .velocity = glm::vec2(0.0f, 60.0f),
+      .size = glm::vec2(20.f),
+      .color = glm::vec3(1.0f),
+    },
+    PowerUpConfig
+    {
+      .type = POWER_UP_PASS_THROUGH,
+      .chance = 2,
+      .ttl = 10.0f,
+      .sprite = 0,
+      .velocity = glm::vec2(0.0f, 200.0f),
+      .size = glm::vec2(20.f),
+      .color = glm::vec3(1.0f),
+    },
+    PowerUpConfig
+    {
+      .type = POWER_UP_PADDLE_SIZE_UP,
+      .chance = 2,
+      .ttl = 10.0f,
+      .sprite = 0,
+      .velocity = glm::vec2(0.0f, 140.0f),
+      .size = glm::vec2(20.f),
+      .color = glm::vec3(1.0f),
+    },
+    PowerUpConfig
+    {
+      .type = POWER_UP_CONFUSION,
+      .chance = 8,
+      .ttl = 5.0f,
+      .sprite = 0,
+      .velocity = glm::vec2(0.0f, 100.0f),
+      .size = glm::vec2(20.f),
+      .color = glm::vec3(1.0f),
+    },
+    PowerUpConfig
+    {
+      .type = POWER_UP_CHAOS,
+      .chance = 8,
+      .ttl = 5.0f,
+      .sprite = 0,
+      .velocity = glm::vec2(0.0f, 50.0f),
+      .size = glm::vec2(20.f),
+      .color = glm::vec3(1.0f),
+    },
+  };
+  GameLevelConfig gameLevelConfig =
+  {
+    .tileMap = tileMap,
+    .width = width,
+    .height = height,
+    .seed = 0,
+    .playerConfig = playerConfig,
+    .ballConfig = ballConfig,
+    .shakeEffectConfig = shakeEffectConfig,
+    .powerUpConfigs = powerUpConfigs,
+    .background = 0,
+    .blockSolid = 0,
+    .blockDestroyable = 0,
+    .spriteShader = 0,
+    .particleShader = 0
+  };
+  return gameLevelConfig;
+}
+
+// many balls in flight from the start and none ever lost, so every frame carries the same load; every ball emits two
+// particles a step that live a second, so a trail of millions of particles takes thousands of balls to fill
+GameLevelConfig createStressGameLevelConfig(GameLevelConfig gameLevelConfig, unsigned int ballCount, unsigned int particleCount)
+{
+  gameLevelConfig.ballConfig.count = ballCount;
+  gameLevelConfig.ballConfig.floorReflects = true;
+  gameLevelConfig.ballConfig.particleCount = particleCount;
+  return gameLevelConfig;
+}
+
+Simulation createSimulation(float timestep)
+{
+  return Simulation
+  { .timestep = timestep,
+    .step = 0,
+    .time = 0.0f,
+    .accumulator = 0.0f
+  };
+}
+
+void stepSimulation(Simulation& simulation, InputSource& inputSource, GameLevel& gameLevel)
+{
+  UpdateState updateState =
+  { .deltaTime = simulation.timestep,
+    .input = inputSource(simulation.step, gameLevel)
+  };
+  updateGameLevel(updateState, gameLevel);
+  simulation.step++;
+  simulation.time += simulation.timestep;
+}
+
+// hands elapsed real time to the simulation and takes as many whole steps as it covers, at most maxSteps; time past
+// that is dropped rather than carried, so a hitch slows the game down for a moment instead of leaving every later frame
+// with more steps to catch up on than it has time for. returns the number of steps taken
+unsigned int advanceSimulation(Simulation& simulation, InputSource& inputSource, GameLevel& gameLevel, float elapsed, unsigned int maxSteps)
+{
+  simulation.accumulator += elapsed;
+  unsigned int steps = 0;
+  while (simulation.accumulator >= simulation.timestep && steps < maxSteps)
+  {
+    stepSimulation(simulation, inputSource, gameLevel);
+    simulation.accumulator -= simulation.timestep;
+    steps++;
+  }
+  simulation.accumulator = std::min(simulation.accumulator, simulation.timestep * 0.999f);
+  return steps;
+}
+
+// how far between the last two steps a frame drawn now falls, 0 at the previous state and 1 at the current one
+float simulationInterpolation(Simulation& simulation)
+{
+  return std::clamp(simulation.accumulator / simulation.timestep, 0.0f, 1.0f);
+}
+
+// replays a recorded input stream, holding the last input once the stream runs out
+InputSource createScriptedInputSource(std::vector<GameInput> inputs)
+{
+  return [inputs](unsigned long step, GameLevel& gameLevel)
+  {
+    if (inputs.empty())
+    {
+      return GameInput { .left = false, .right = false, .launch = false };
+    }
+    return inputs[std::min<size_t>(step, inputs.size() - 1)];
+  };
+}
+
+// keeps the paddle under the first ball and launches it whenever it is stuck to the paddle
+InputSource createAutopilotInputSource()
+{
+  return [](unsigned long step, GameLevel& gameLevel)
+  {
+    float paddleCenter = gameLevel.player.position.x + gameLevel.player.size.x / 2.0f;
+    float ballCenter = gameLevel.balls.position[0].x + gameLevel.balls.radius;
+    float deadZone = gameLevel.player.size.x / 4.0f;
+    return GameInput
+    { .left = ballCenter < paddleCenter - deadZone,
+      .right = ballCenter > paddleCenter + deadZone,
+      .launch = gameLevel.balls.surfaceType[0] == BALL_OBJECT_SURFACE_STICKY
+    };
+  };
+}
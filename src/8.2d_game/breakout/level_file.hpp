@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include "mapped_file.hpp"
+
+const char LEVEL_FILE_MAGIC[4] = { 'B', 'K', 'L', 'V' };
+const uint32_t LEVEL_FILE_VERSION = 1;
+
+// a compiled level is the header, kindCount tile kinds and then columns * rows one byte kind indices in row-major order,
+// everything little endian; the kinds carry the finished tile type and color so loading does no parsing at all
+struct LevelFileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t columns;
+  uint32_t rows;
+  uint32_t kindCount;
+  uint32_t brickCount;
+};
+
+struct LevelFileTileKind
+{
+  uint32_t type;
+  float color[3];
+};
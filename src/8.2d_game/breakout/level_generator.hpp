@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cmath>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include "game.hpp"
+#include "random.hpp"
+#include "work_pool.hpp"
+
+// below this many tiles the threads cost more to start than the generation itself
+const unsigned long LEVEL_GENERATOR_PARALLEL_TILES = 1ul << 16;
+const unsigned int LEVEL_GENERATOR_ROWS_PER_JOB = 64;
+// the tile codes createTile knows, the generated palette holds them in this order so a kind is its code
+const unsigned int LEVEL_GENERATOR_KIND_COUNT = 6;
+
+enum LevelPattern
+{
+  LEVEL_PATTERN_NOISE, // every tile on its own
+  LEVEL_PATTERN_ROWS, // whole rows are filled or left empty, one color per row
+  LEVEL_PATTERN_CHECKER, // only every other tile can hold a brick
+  LEVEL_PATTERN_PYRAMID, // bricks inside a triangle widening towards the bottom row
+};
+
+// fill is the chance a tile the pattern allows holds a brick, solidRatio the chance such a brick is solid
+struct LevelGeneratorConfig
+{
+  unsigned int columns;
+  unsigned int rows;
+  uint64_t seed;
+  LevelPattern pattern;
+  float fill;
+  float solidRatio;
+  unsigned int threads;
+};
+
+LevelGeneratorConfig createLevelGeneratorConfig(unsigned long tileCount, uint64_t seed)
+{
+  // twice as wide as high, like the shipped levels
+  unsigned int rows = std::max(1u, (unsigned int)std::lround(std::sqrt(tileCount / 2.0)));
+  unsigned int columns = std::max(1u, (unsigned int)((tileCount + rows - 1) / rows));
+  return LevelGeneratorConfig
+  { .columns = columns,
+    .rows = rows,
+    .seed = seed,
+    .pattern = LEVEL_PATTERN_NOISE,
+    .fill = 0.8f,
+    .solidRatio = 0.1f,
+    .threads = std::max(1u, std::thread::hardware_concurrency())
+  };
+}
+
+std::optional<LevelPattern> parseLevelPattern(std::string name)
+{
+  if (name == "noise")
+    return LEVEL_PATTERN_NOISE;
+  if (name == "rows")
+    return LEVEL_PATTERN_ROWS;
+  if (name == "checker")
+    return LEVEL_PATTERN_CHECKER;
+  if (name == "pyramid")
+    return LEVEL_PATTERN_PYRAMID;
+  return {};
+}
+
+// a chance in [0, 1] as the bound a 32 bit random number has to stay under
+uint64_t levelGeneratorThreshold(float chance)
+{
+  return (uint64_t)((double)std::clamp(chance, 0.0f, 1.0f) * 4294967296.0);
+}
+
+bool isLevelPatternTile(LevelGeneratorConfig& config, unsigned int x, unsigned int y)
+{
+  if (config.pattern == LEVEL_PATTERN_CHECKER)
+  {
+    return (x + y) % 2 == 0;
+  }
+  if (config.pattern == LEVEL_PATTERN_PYRAMID)
+  {
+    double halfWidth = config.columns * (y + 1.0) / (2.0 * config.rows);
+    return std::abs(x + 0.5 - config.columns / 2.0) <= halfWidth;
+  }
+  return true;
+}
+
+// every row draws from its own stream, so the level depends only on the seed and not on how rows are shared out
+// between threads; returns the number of bricks placed
+unsigned long generateLevelRow(LevelGeneratorConfig& config, unsigned int y, uint8_t* row)
+{
+  RandomStream random = createRandomStream(config.seed, y);
+  uint64_t fill = levelGeneratorThreshold(config.fill);
+  uint64_t solid = levelGeneratorThreshold(config.solidRatio);
+  bool rowFilled = config.pattern != LEVEL_PATTERN_ROWS || nextRandom(random) < fill;
+  unsigned long bricks = 0;
+  for (unsigned int x = 0; x < config.columns; x++)
+  {
+    row[x] = 0;
+    if (!rowFilled || !isLevelPatternTile(config, x, y) || (config.pattern != LEVEL_PATTERN_ROWS && nextRandom(random) >= fill))
+    {
+      continue;
+    }
+    if (nextRandom(random) < solid)
+    {
+      row[x] = 1;
+    }
+    else
+    {
+      row[x] = config.pattern == LEVEL_PATTERN_ROWS ? 2 + y % 4 : 2 + nextRandomBelow(random, 4);
+    }
+    bricks++;
+  }
+  return bricks;
+}
+
+// the tiles are written straight into the map's storage, large levels are generated a band of rows per job on the
+// work-stealing pool
+TileMap generateTileMap(LevelGeneratorConfig& config)
+{
+  size_t tileCount = (size_t)config.columns * config.rows;
+  std::shared_ptr<std::vector<uint8_t>> tiles = std::make_shared<std::vector<uint8_t>>(tileCount);
+  TileMap tileMap =
+  { .columns = config.columns,
+    .rows = config.rows,
+    .brickCount = 0,
+    .palette = {},
+    .tiles = tiles->data(),
+    .storage = tiles
+  };
+  for (unsigned int code = 0; code < LEVEL_GENERATOR_KIND_COUNT; code++)
+  {
+    tileMap.palette.push_back(createTile(code));
+  }
+  std::atomic<unsigned long> brickCount = 0;
+  unsigned int jobCount = (config.rows + LEVEL_GENERATOR_ROWS_PER_JOB - 1) / LEVEL_GENERATOR_ROWS_PER_JOB;
+  unsigned int threads = tileCount < LEVEL_GENERATOR_PARALLEL_TILES ? 1 : config.threads;
+  runWorkStealing(threads, jobCount, [&](unsigned int job)
+  {
+    unsigned long bricks = 0;
+    unsigned int lastRow = std::min(config.rows, (job + 1) * LEVEL_GENERATOR_ROWS_PER_JOB);
+    for (unsigned int y = job * LEVEL_GENERATOR_ROWS_PER_JOB; y < lastRow; y++)
+    {
+      bricks += generateLevelRow(config, y, tiles->data() + (size_t)y * config.columns);
+    }
+    brickCount += bricks;
+  });
+  tileMap.brickCount = brickCount;
+  return tileMap;
+}
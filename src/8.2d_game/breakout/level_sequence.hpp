@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <functional>
+#include "game.hpp"
+
+// builds the config of a level from its index, it runs on the prefetch thread as well so it must not touch GL
+using LevelConfigSource = std::function<GameLevelConfig(unsigned int level)>;
+
+// levels are only built when they are entered, and the one after the current level is built on a background thread
+// while the current one is played; nothing is kept per level that is not being played, so startup and memory do not
+// grow with the number of levels
+struct LevelSequence
+{
+  unsigned int count;
+  LevelConfigSource configSource;
+  std::future<GameLevel> prefetch;
+  unsigned int prefetchLevel;
+  unsigned int entered;
+  unsigned int prefetchHits;
+  double waitSeconds; // time entering a level blocked the caller, building it or waiting for the prefetch to finish
+};
+
+LevelSequence createLevelSequence(unsigned int count, LevelConfigSource configSource)
+{
+  return LevelSequence
+  { .count = count,
+    .configSource = configSource,
+    .prefetch = {},
+    .prefetchLevel = 0,
+    .entered = 0,
+    .prefetchHits = 0,
+    .waitSeconds = 0.0
+  };
+}
+
+GameLevel buildSequenceLevel(LevelConfigSource& configSource, unsigned int level)
+{
+  return createGameLevel(std::make_shared<const GameLevelConfig>(configSource(level)));
+}
+
+void prefetchSequenceLevel(LevelSequence& sequence, unsigned int level)
+{
+  if (level >= sequence.count || (sequence.prefetch.valid() && sequence.prefetchLevel == level))
+  {
+    return;
+  }
+  LevelConfigSource configSource = sequence.configSource;
+  sequence.prefetchLevel = level;
+  sequence.prefetch = std::async(std::launch::async, [configSource, level]() mutable
+  {
+    return buildSequenceLevel(configSource, level);
+  });
+}
+
+// the prefetched level is taken if it is the one asked for, otherwise the level is built here; either way the next level
+// starts prefetching before this returns. a prefetch of any other level is dropped unless it is the next one, and since
+// a running prefetch can not be stopped dropping it waits for it, which counts as waiting too
+GameLevel enterSequenceLevel(LevelSequence& sequence, unsigned int level)
+{
+  auto start = std::chrono::steady_clock::now();
+  unsigned int next = (level + 1) % sequence.count;
+  bool prefetched = sequence.prefetch.valid() && sequence.prefetchLevel == level;
+  if (!prefetched && sequence.prefetch.valid() && sequence.prefetchLevel != next)
+  {
+    sequence.prefetch.wait();
+    sequence.prefetch = {};
+  }
+  GameLevel gameLevel = prefetched ? sequence.prefetch.get() : buildSequenceLevel(sequence.configSource, level);
+  sequence.prefetchHits += prefetched;
+  sequence.waitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  sequence.entered++;
+  prefetchSequenceLevel(sequence, next);
+  return gameLevel;
+}
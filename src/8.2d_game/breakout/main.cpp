@@ -1,26 +1,25 @@
+#include <array>
 #include <tuple>
+#include <chrono>
+#include <string>
+#include <thread>
 #include <vector>
 #include <optional>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <unordered_map>
 #include <stb_image.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
-
-struct Texture
-{
-  // holds the ID of the texture object, used for all texture operations to reference to this particular texture
-  unsigned int id;
-  // texture image dimensions
-  int width;
-  int height; // width and height of loaded image in pixels
-  int channels;
-};
+#include "game.hpp"
+#include "texture_atlas.hpp"
+#include "replay.hpp"
+#include "level_sequence.hpp"
 
 struct RenderState
 {
@@ -29,6 +28,8 @@ struct RenderState
   float lastFrame;
   int bufferWidth;
   int bufferHeight;
+  float interpolation; // how far past the last simulated state the frame is drawn, in simulation steps
+  float timestep;
 };
 
 struct WindowSettings
@@ -38,39 +39,51 @@ struct WindowSettings
   std::string title;
 };
 
-struct SpriteVertex
-{
-  glm::vec2 position;
-  glm::vec2 textureCoordinate;
-};
-
-struct Sprite
+// bits of a post-processor shader variant, the variant without any bit is never compiled since no effect
+// renders straight to the window
+enum PostProcessorEffect
 {
-  Texture texture;
-  std::vector<SpriteVertex> vertices;
-  unsigned int vao;
-  unsigned int vbo;
+  POST_PROCESSOR_CHAOS = 1,
+  POST_PROCESSOR_CONFUSE = 2,
+  POST_PROCESSOR_SHAKE = 4,
 };
 
-struct ParticleVertex
-{
-  glm::vec2 position;
-  glm::vec2 textureCoordinate;
+const unsigned int POST_PROCESSOR_VARIANT_COUNT = 8;
+// the blur runs on targets this many times smaller than the window in each direction
+const int POST_PROCESSOR_BLUR_DOWNSCALE = 2;
+
+struct GameSettings
+{
+  ParticleBackend particleBackend;
+  unsigned long frames; // closes the window after this many frames, 0 runs until it is closed
+  unsigned int effects; // PostProcessorEffect bits forced on for every frame, to measure the effect chain
+  uint64_t seed; // level i is seeded with seed + i
+  unsigned int balls; // above 0 every level starts with this many balls in flight and none are lost
+  unsigned int particleCount; // size of the trail every level's balls share
+  std::filesystem::path recordPath; // the session is written here as a replay when the window closes
+  std::filesystem::path replayPath; // plays this replay back instead of reading the keys
+  float tickRate; // simulation steps per second, whatever the frame rate; a replay brings its own
+  unsigned int maxStepsPerFrame; // real time that would need more steps than this in one frame is dropped
+  bool vsync;
+  float frameRate; // frames are paced to this rate on the cpu, 0 draws as fast as the swap allows
 };
 
-struct ParticleIntanceVertex
+struct FrameStats
 {
-  glm::vec2 offset;
-  glm::vec4 color;
+  unsigned long frames;
+  double cpuSeconds;
+  double simulationSeconds;
+  double renderSeconds;
+  unsigned long steps;
+  unsigned long gpuFrames;
+  double gpuSeconds;
 };
 
-struct Particle
+enum SpriteLayer
 {
-  Texture texture;
-  std::vector<ParticleVertex> vertices;
-  unsigned int vao;
-  unsigned int vbo;
-  unsigned int instanceVbo;
+  SPRITE_LAYER_BACKGROUND,
+  SPRITE_LAYER_BRICKS,
+  SPRITE_LAYER_OBJECTS,
 };
 
 struct PostProcessorVertex
@@ -79,108 +92,104 @@ struct PostProcessorVertex
   glm::vec2 textureCoordinate;
 };
 
-struct PostProcessor
+struct PostProcessorTarget
 {
-  std::vector<PostProcessorVertex> vertices;
-  unsigned int vao;
-  unsigned int vbo;
   unsigned int fbo;
-  unsigned int rbo;
-  unsigned int tid;
-  bool confuse;
-  bool chaos;
-  bool shake;
-  float offsets[9][2];
-  int edgeKernel[9];
-  float blurKernel[9];
-};
-
-struct ShakeEffectConfig
-{
-  float duration;
-};
-
-struct ShakeEffect
-{
-  float ttl;
-};
-
-struct EntityAttributes
-{
-  glm::vec2 position;
-  glm::vec2 size;
-  float rotation;
-  glm::vec3 color;
+  unsigned int texture;
+  int width;
+  int height;
 };
 
-enum TileType
+struct PostProcessorStats
 {
-  TILE_TYPE_SOLID,
-  TILE_TYPE_EMPTY,
-  TILE_TYPE_DESTROYABLE
+  unsigned long frames;
+  unsigned long bypassedFrames;
+  unsigned long passes;
 };
 
-struct Tile
+// the scene is only drawn off-screen while an effect is live, the blur then ping-pongs through two reduced
+// resolution targets before the variant for the live effects draws the result to the window
+struct PostProcessor
 {
-  TileType type;
-  glm::vec3 color;
+  std::vector<PostProcessorVertex> vertices;
+  unsigned int vao;
+  unsigned int vbo;
+  PostProcessorTarget scene;
+  std::array<PostProcessorTarget, 2> blurTargets;
+  std::array<unsigned int, POST_PROCESSOR_VARIANT_COUNT> shaders; // indexed by PostProcessorEffect bits
+  unsigned int blurShader;
+  PostProcessorStats stats;
 };
 
-struct TileMap
-{
-  std::vector<std::vector<Tile>> grid;
-};
+// past this many bricks gone in one frame the scissored redraws cost more than drawing the layer again
+const unsigned int STATIC_LAYER_MAX_TILE_REDRAWS = 64;
 
-enum Direction
+struct StaticLayerStats
 {
-  DIRECTION_UP,
-  DIRECTION_DOWN,
-  DIRECTION_LEFT,
-  DIRECTION_RIGHT,
+  unsigned long frames;
+  unsigned long fullRedraws;
+  unsigned long tileRedraws;
 };
 
-struct Collision
+// the background and the bricks drawn once into a window-sized texture, each frame copies it to the target in one blit;
+// config and restores tell a different level or a restart, which redraw everything, from bricks going one by one,
+// which redraw only their tiles
+struct StaticLayer
 {
-  Direction direction;
-  glm::vec2 difference;
+  PostProcessorTarget target;
+  std::shared_ptr<const GameLevelConfig> config;
+  unsigned int restores;
+  unsigned int drawnBricks; // how much of the map's destroyedBricks the texture already shows
+  StaticLayerStats stats;
 };
 
-struct AabbCollisionBox
+// every sprite and the particles are drawn from this one texture, it is bound once per frame
+struct TextureAtlas
 {
-  glm::vec2 topLeft;
-  glm::vec2 bottomRight;
+  Texture texture;
+  std::vector<std::string> names;
+  std::vector<glm::vec4> textureRects; // <vec2 offset, vec2 size> in texture coordinates
 };
 
-struct AabbCollisionCircle
+struct SpriteInstance
 {
-  float radius;
-  glm::vec2 center;
+  glm::vec4 rect; // <vec2 position, vec2 size>
+  float rotation;
+  glm::vec3 color;
+  glm::vec4 textureRect;
 };
 
-enum GameObjectBodyType
+struct SpriteBatchGroup
 {
-  GAME_OBJECT_BODY_SOLID,
-  GAME_OBJECT_BODY_DESTROYABLE
+  SpriteLayer layer;
+  unsigned int offset;
+  std::vector<SpriteInstance> instances;
 };
 
-enum GameObjectStatus
+struct SpriteBatchStats
 {
-  GAME_OBJECT_ALIVE,
-  GAME_OBJECT_DESTROYED,
+  unsigned long frames;
+  unsigned long sprites;
+  unsigned long drawCalls;
 };
 
-struct GameObject
+struct SpriteBatch
 {
-  glm::vec2 position;
-  glm::vec2 size;
-  float rotation;
-  glm::vec3 color;
-  GameObjectBodyType bodyType;
-  GameObjectStatus status;
-  Sprite sprite;
+  unsigned int shader;
+  int projectionLocation;
+  int textureLocation;
+  std::vector<SpriteVertex> vertices;
+  unsigned int vao;
+  unsigned int vbo;
+  unsigned int instanceVbo;
+  unsigned int instanceCapacity;
+  // groups and the staging buffer keep their capacity between frames so steady state batching does not allocate
+  std::vector<SpriteBatchGroup> groups;
+  std::vector<SpriteInstance> instances;
+  SpriteBatchStats stats;
 };
 
-struct ParticleObject
+struct GpuParticleVertex
 {
   glm::vec2 position;
   glm::vec2 velocity;
@@ -188,147 +197,30 @@ struct ParticleObject
   float life;
 };
 
-enum BallObjectSurfaceType
-{
-  BALL_OBJECT_SURFACE_STICKY,
-  BALL_OBJECT_SURFACE_REFLECT,
-};
-
-enum BallObjectCollisionType
-{
-  BALL_OBJECT_COLLISION_DEFAULT,
-  BALL_OBJECT_COLLISION_PASS_THROUGH,
-};
-
-struct BallConfig
-{
-  float speed;
-  float radius;
-  glm::vec3 color;
-  Sprite sprite;
-  unsigned int particleCount;
-  Particle particleModel;
-};
-
-struct BallObject : GameObject
-{
-  float speed;
-  float radius;
-  glm::vec2 velocity;
-  BallObjectSurfaceType surfaceType;
-  BallObjectCollisionType collisionType;
-  std::vector<ParticleObject> particles;
-  Particle particleModel;
-};
-
-struct PlayerConfig
-{
-  float velocity;
-  glm::vec2 size;
-  glm::vec3 color;
-  Sprite sprite;
-};
-
-struct PlayerObject : GameObject
-{
-  float velocity;
-};
-
-enum PowerUpType
-{
-  POWER_UP_SPEED,
-  POWER_UP_STICKY,
-  POWER_UP_PASS_THROUGH,
-  POWER_UP_PADDLE_SIZE_UP,
-  POWER_UP_CONFUSION,
-  POWER_UP_CHAOS,
-};
-
-struct PowerUpConfig
-{
-  PowerUpType type;
-  int chance;
-  float ttl;
-  Sprite sprite;
-  glm::vec2 velocity;
-  glm::vec2 size;
-  glm::vec3 color;
-};
-
-struct PowerUpObject : GameObject
-{
-  PowerUpType type;
-  glm::vec2 velocity;
-};
-
-enum PowerUpEffectStatus
-{
-  POWER_UP_EFFECT_IDLE,
-  POWER_UP_EFFECT_STATUS_ACTIVATE,
-  POWER_UP_EFFECT_STATUS_ACTIVATED,
-  POWER_UP_EFFECT_STATUS_DEACTIVATE,
-  POWER_UP_EFFECT_STATUS_DEACTIVATED
-};
-
-struct PowerUpEffect
-{
-  PowerUpType type;
-  float ttl;
-  PowerUpEffectStatus status;
-};
-
-struct GameLevelConfig
-{
-  TileMap tileMap;
-  unsigned int width;
-  unsigned int height;
-  PlayerConfig playerConfig;
-  BallConfig ballConfig;
-  ShakeEffectConfig shakeEffectConfig;
-  std::vector<PowerUpConfig> powerUpConfigs;
-  Sprite background;
-  Sprite blockSolid;
-  Sprite blockDestroyable;
-  unsigned int spriteShader;
-  unsigned int particleShader;
-  unsigned int postProcessorShader;
-};
-
-struct GameLevelMap
-{
-  unsigned int width;
-  unsigned int height;
-  std::vector<GameObject> bricks;
-  glm::mat4 projection;
-  Sprite background;
+// the trail simulated on the gpu: a fixed ring of particles ping-pongs between two buffers through transform feedback,
+// new particles overwrite the oldest slots, and dead ones stay in the ring fully transparent so the instance count
+// never has to be read back
+struct GpuParticles
+{
+  unsigned int updateShader;
+  unsigned int capacity;
+  unsigned int current; // the buffer holding the latest state, the next update writes the other one
+  unsigned int spawnCursor;
+  std::array<unsigned int, 2> buffers;
+  std::array<unsigned int, 2> updateVaos;
+  std::array<unsigned int, 2> drawVaos;
+  unsigned int spawnBuffer;
+  unsigned int spawnTexture;
 };
 
-struct GameLevel
+struct Renderer
 {
-  GameLevelConfig config;
-  GameLevelMap map;
-  PlayerObject player;
-  BallObject ball;
+  ResourceRegistry resources;
+  TextureAtlas atlas;
+  SpriteBatch spriteBatch;
   PostProcessor postProcessor;
-  ShakeEffect shakeEffect;
-  std::vector<PowerUpObject> powerUps;
-  std::vector<PowerUpEffect> powerUpEffects;
-};
-
-enum GameStatus
-{
-  GAME_ACTIVE,
-  GAME_MENU,
-  GAME_WIN,
-};
-
-struct GameState
-{
-  int width;
-  int height;
-  GameStatus status;
-  std::vector<GameLevel> levels;
-  unsigned int level;
+  GpuParticles gpuParticles;
+  StaticLayer staticLayer;
 };
 
 std::stringstream readFile(std::filesystem::path path)
@@ -357,19 +249,31 @@ unsigned int createShader(const char* source, GLenum type)
   return shader;
 }
 
-unsigned int loadShader(std::filesystem::path path, GLenum type)
+// defines are inserted right after the #version line, which has to stay first
+unsigned int loadShader(std::filesystem::path path, GLenum type, std::vector<std::string> defines = {})
 {
   std::string source = readFile(path).str();
+  std::string header = {};
+  for (std::string& define : defines)
+  {
+    header += "#define " + define + "\n";
+  }
+  source.insert(source.find('\n') + 1, header);
   return createShader(source.c_str(), type);
 }
 
-unsigned int createShaderProgram(std::vector<unsigned int> shaders)
+// feedbackVaryings are the outputs captured by transform feedback, they have to be named before linking
+unsigned int createShaderProgram(std::vector<unsigned int> shaders, std::vector<const char*> feedbackVaryings = {})
 {
   unsigned int shaderProgram = glCreateProgram();
   for (unsigned int shader : shaders)
   {
     glAttachShader(shaderProgram, shader);
   }
+  if (!feedbackVaryings.empty())
+  {
+    glTransformFeedbackVaryings(shaderProgram, feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+  }
   glLinkProgram(shaderProgram);
   int success;
   glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
@@ -382,83 +286,49 @@ unsigned int createShaderProgram(std::vector<unsigned int> shaders)
   return shaderProgram;
 }
 
-GLenum textureFormatFromChannel(int channels)
-{
-  GLenum format = GL_RED;
-  if (channels == 1)
-      format = GL_RED;
-  else if (channels == 3)
-      format = GL_RGB;
-  else if (channels == 4)
-      format = GL_RGBA;
-  return format;
-}
-
-Texture loadTexture(std::filesystem::path path, bool flip)
+// the atlas keeps a few mip levels for the minified background, no more than the padding between sprites can cover
+TextureAtlas createTextureAtlas(TextureAtlasImage& image)
 {
-  int width, height, channels;
-  stbi_set_flip_vertically_on_load(flip);
-  unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
-  stbi_set_flip_vertically_on_load(false);
-  unsigned int id;
-  glGenTextures(1, &id);
-  if (data)
-  {
-    GLenum format = textureFormatFromChannel(channels);
-    glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  }
-  else
+  TextureAtlas atlas =
+  { .texture = Texture { .width = (int)image.width, .height = (int)image.height, .channels = 4 },
+    .names = image.names,
+    .textureRects = {}
+  };
+  for (TextureAtlasRect& rect : image.rects)
   {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
+    atlas.textureRects.push_back(glm::vec4(rect.x, rect.y, rect.width, rect.height) / glm::vec4(image.width, image.height, image.width, image.height));
   }
-  stbi_image_free(data);
-  Texture texture =
-  {
-    .id = id,
-    .width = width,
-    .height = height,
-    .channels = channels
-  };
-  return texture;
+  glGenTextures(1, &atlas.texture.id);
+  glBindTexture(GL_TEXTURE_2D, atlas.texture.id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, TEXTURE_ATLAS_MAX_MIP_LEVEL);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return atlas;
 }
 
-Sprite createSprite(Texture texture)
+// sprites are looked up by the file name of their image without the extension
+Sprite findAtlasSprite(TextureAtlas& atlas, std::string name)
 {
-  std::vector<SpriteVertex> vertices =
-  {
-    SpriteVertex { glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, 1.0f) },
-    SpriteVertex { glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 0.0f) },
-    SpriteVertex { glm::vec2(0.0f, 0.0f), glm::vec2(0.0f, 0.0f) },
-    SpriteVertex { glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, 1.0f) },
-    SpriteVertex { glm::vec2(1.0f, 1.0f), glm::vec2(1.0f, 1.0f) },
-    SpriteVertex { glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 0.0f) },
-  };
-  Sprite sprite =
+  for (unsigned int i = 0; i < atlas.names.size(); i++)
   {
-    .texture = texture,
-    .vertices = vertices
-  };
-  glGenVertexArrays(1, &sprite.vao);
-  glBindVertexArray(sprite.vao);
-  glGenBuffers(1, &sprite.vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, sprite.vbo);
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SpriteVertex), &vertices[0], GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(offsetof(SpriteVertex, position)));
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(offsetof(SpriteVertex, textureCoordinate)));
-  glEnableVertexAttribArray(1);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
-  return sprite;
+    if (atlas.names[i] == name)
+    {
+      return Sprite { .textureRect = atlas.textureRects[i] };
+    }
+  }
+  std::cout << "ERROR::TEXTURE_ATLAS::SPRITE_NOT_FOUND " << name << std::endl;
+  return Sprite { .textureRect = glm::vec4(0.0f) };
 }
 
-Particle createParticle(Texture texture)
+// the instance buffer starts with room for capacity particles and drawParticles grows it when a trail outgrows it; the
+// particle lives once in the registry, so every level draws through the same buffer and the same recorded capacity
+Particle createParticle(Sprite sprite, unsigned int capacity)
 {
   std::vector<ParticleVertex> vertices =
   { ParticleVertex { glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, 1.0f) },
@@ -469,8 +339,9 @@ Particle createParticle(Texture texture)
     ParticleVertex { glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 0.0f) },
   };
   Particle particle = Particle
-  { .vertices = vertices,
-    .texture = texture
+  { .textureRect = sprite.textureRect,
+    .vertices = vertices,
+    .instanceCapacity = capacity
   };
   glGenVertexArrays(1, &particle.vao);
   glBindVertexArray(particle.vao);
@@ -482,12 +353,103 @@ Particle createParticle(Texture texture)
   glEnableVertexAttribArray(0);
   glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)(offsetof(ParticleVertex, textureCoordinate)));
   glEnableVertexAttribArray(1);
+  // the instance attributes always read from the start of the instance buffer, so they are set up once here
+  // and stay valid when drawParticles orphans its storage
+  glBindBuffer(GL_ARRAY_BUFFER, particle.instanceVbo);
+  glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(ParticleIntanceVertex), NULL, GL_STREAM_DRAW);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleIntanceVertex), (void*)(offsetof(ParticleIntanceVertex, offset)));
+  glEnableVertexAttribArray(2);
+  glVertexAttribDivisor(2, 1);
+  glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleIntanceVertex), (void*)(offsetof(ParticleIntanceVertex, color)));
+  glEnableVertexAttribArray(3);
+  glVertexAttribDivisor(3, 1);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
   return particle;
 }
 
-PostProcessor createPostProcessor(RenderState& renderState)
+GpuParticles createGpuParticles(Particle& particle, unsigned int updateShader, unsigned int capacity)
+{
+  GpuParticles gpuParticles = GpuParticles
+  { .updateShader = updateShader,
+    .capacity = capacity,
+    .current = 0,
+    .spawnCursor = 0
+  };
+  // zeroed particles are dead and transparent
+  std::vector<GpuParticleVertex> particles(capacity, GpuParticleVertex {});
+  glGenBuffers(2, gpuParticles.buffers.data());
+  glGenVertexArrays(2, gpuParticles.updateVaos.data());
+  glGenVertexArrays(2, gpuParticles.drawVaos.data());
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, gpuParticles.buffers[i]);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GpuParticleVertex), particles.data(), GL_DYNAMIC_COPY);
+    glBindVertexArray(gpuParticles.updateVaos[i]);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GpuParticleVertex), (void*)(offsetof(GpuParticleVertex, position)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GpuParticleVertex), (void*)(offsetof(GpuParticleVertex, velocity)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(GpuParticleVertex), (void*)(offsetof(GpuParticleVertex, color)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(GpuParticleVertex), (void*)(offsetof(GpuParticleVertex, life)));
+    glEnableVertexAttribArray(3);
+    // drawn with the same quad and shader as the cpu trail, the ring itself is the instance buffer
+    glBindVertexArray(gpuParticles.drawVaos[i]);
+    glBindBuffer(GL_ARRAY_BUFFER, particle.vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)(offsetof(ParticleVertex, position)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)(offsetof(ParticleVertex, textureCoordinate)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, gpuParticles.buffers[i]);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(GpuParticleVertex), (void*)(offsetof(GpuParticleVertex, position)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(GpuParticleVertex), (void*)(offsetof(GpuParticleVertex, color)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+  }
+  glBindVertexArray(0);
+  glGenBuffers(1, &gpuParticles.spawnBuffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, gpuParticles.spawnBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, capacity * 3 * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+  glGenTextures(1, &gpuParticles.spawnTexture);
+  glBindTexture(GL_TEXTURE_BUFFER, gpuParticles.spawnTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, gpuParticles.spawnBuffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return gpuParticles;
+}
+
+// color only, nothing drawn into it uses depth or stencil
+PostProcessorTarget createPostProcessorTarget(int width, int height)
+{
+  PostProcessorTarget target = { .width = width, .height = height };
+  glGenFramebuffers(1, &target.fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+  glGenTextures(1, &target.texture);
+  glBindTexture(GL_TEXTURE_2D, target.texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  return target;
+}
+
+unsigned int postProcessorVariant(ScreenEffects& effects, unsigned int forcedEffects)
+{
+  return forcedEffects
+    | (effects.chaos ? POST_PROCESSOR_CHAOS : 0)
+    | (effects.confuse ? POST_PROCESSOR_CONFUSE : 0)
+    | (effects.shake ? POST_PROCESSOR_SHAKE : 0);
+}
+
+PostProcessor createPostProcessor(RenderState& renderState, std::filesystem::path staticFilePath)
 {
   std::vector<PostProcessorVertex> vertices =
   { PostProcessorVertex { glm::vec2(-1.0f, -1.0f), glm::vec2(0.0f, 0.0f) },
@@ -497,50 +459,33 @@ PostProcessor createPostProcessor(RenderState& renderState)
     PostProcessorVertex { glm::vec2(1.0f, -1.0f), glm::vec2(1.0f, 0.0f) },
     PostProcessorVertex { glm::vec2(1.0f, 1.0f), glm::vec2(1.0f, 1.0f) },
   };
-  float offset = 1.0f / 300.0f;
+  int blurWidth = std::max(1, renderState.bufferWidth / POST_PROCESSOR_BLUR_DOWNSCALE);
+  int blurHeight = std::max(1, renderState.bufferHeight / POST_PROCESSOR_BLUR_DOWNSCALE);
   PostProcessor postProcessor = PostProcessor
   { .vertices = vertices,
-    .confuse = false,
-    .chaos = false,
-    .shake = false,
-    .offsets = {
-      { -offset,  offset  },  // top-left
-      {  0.0f,    offset  },  // top-center
-      {  offset,  offset  },  // top-right
-      { -offset,  0.0f    },  // center-left
-      {  0.0f,    0.0f    },  // center-center
-      {  offset,  0.0f    },  // center - right
-      { -offset, -offset  },  // bottom-left
-      {  0.0f,   -offset  },  // bottom-center
-      {  offset, -offset  }   // bottom-right    
-    },
-    .edgeKernel = {
-      -1, -1, -1,
-      -1,  8, -1,
-      -1, -1, -1
-    },
-    .blurKernel = {
-      1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f,
-      2.0f / 16.0f, 4.0f / 16.0f, 2.0f / 16.0f,
-      1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f
-    }
+    .scene = createPostProcessorTarget(renderState.bufferWidth, renderState.bufferHeight),
+    .blurTargets = { createPostProcessorTarget(blurWidth, blurHeight), createPostProcessorTarget(blurWidth, blurHeight) },
+    .shaders = {},
+    .stats = PostProcessorStats { .frames = 0, .bypassedFrames = 0, .passes = 0 }
   };
-  glGenFramebuffers(1, &postProcessor.fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, postProcessor.fbo);
-  glGenTextures(1, &postProcessor.tid);
-  glBindTexture(GL_TEXTURE_2D, postProcessor.tid);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, renderState.bufferWidth, renderState.bufferHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, postProcessor.tid, 0);
-  glGenRenderbuffers(1, &postProcessor.rbo);
-  glBindRenderbuffer(GL_RENDERBUFFER, postProcessor.rbo);
-  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, renderState.bufferWidth, renderState.bufferHeight);
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, postProcessor.rbo);
-  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-  glBindRenderbuffer(GL_RENDERBUFFER, 0);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  for (unsigned int variant = 1; variant < POST_PROCESSOR_VARIANT_COUNT; variant++)
+  {
+    std::vector<std::string> defines = {};
+    if (variant & POST_PROCESSOR_CHAOS)
+      defines.push_back("CHAOS");
+    if (variant & POST_PROCESSOR_CONFUSE)
+      defines.push_back("CONFUSE");
+    if (variant & POST_PROCESSOR_SHAKE)
+      defines.push_back("SHAKE");
+    postProcessor.shaders[variant] = createShaderProgram(
+    { loadShader(staticFilePath / "post_processor.vert", GL_VERTEX_SHADER, defines),
+      loadShader(staticFilePath / "post_processor.frag", GL_FRAGMENT_SHADER, defines)
+    });
+  }
+  postProcessor.blurShader = createShaderProgram(
+  { loadShader(staticFilePath / "post_processor.vert", GL_VERTEX_SHADER),
+    loadShader(staticFilePath / "post_processor_blur.frag", GL_FRAGMENT_SHADER)
+  });
   glGenVertexArrays(1, &postProcessor.vao);
   glBindVertexArray(postProcessor.vao);
   glGenBuffers(1, &postProcessor.vbo);
@@ -555,841 +500,654 @@ PostProcessor createPostProcessor(RenderState& renderState)
   return postProcessor;
 }
 
-PowerUpObject createPowerUp(PowerUpConfig& powerUpConfig, glm::vec2 position)
+// the shake blur, the same 1-2-1 kernel the single 3x3 pass used, split into a horizontal pass that also
+// downsamples the scene and a vertical one, so each pass reads 3 taps on a quarter of the pixels
+unsigned int blurPostProcessorScene(PostProcessor& postProcessor)
+{
+  float offset = 1.0f / 300.0f;
+  std::array<glm::vec2, 2> directions = { glm::vec2(offset, 0.0f), glm::vec2(0.0f, offset) };
+  unsigned int source = postProcessor.scene.texture;
+  glUseProgram(postProcessor.blurShader);
+  glUniform1i(glGetUniformLocation(postProcessor.blurShader, "scene"), 0);
+  for (unsigned int pass = 0; pass < 2; pass++)
+  {
+    PostProcessorTarget& target = postProcessor.blurTargets[pass];
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glViewport(0, 0, target.width, target.height);
+    glUniform2fv(glGetUniformLocation(postProcessor.blurShader, "direction"), 1, glm::value_ptr(directions[pass]));
+    glBindTexture(GL_TEXTURE_2D, source);
+    glDrawArrays(GL_TRIANGLES, 0, postProcessor.vertices.size());
+    postProcessor.stats.passes++;
+    source = target.texture;
+  }
+  return source;
+}
+
+void applyPostProcessor(RenderState& renderState, PostProcessor& postProcessor, unsigned int variant)
 {
-  PowerUpObject powerUp = PowerUpObject
+  glDisable(GL_BLEND);
+  glBindVertexArray(postProcessor.vao);
+  glActiveTexture(GL_TEXTURE0);
+  unsigned int source = postProcessor.scene.texture;
+  if (variant == POST_PROCESSOR_SHAKE)
   {
-    .type = powerUpConfig.type,
-    .velocity = powerUpConfig.velocity,
-  };
-  powerUp.position = position;
-  powerUp.size = powerUpConfig.size;
-  powerUp.rotation = 0.0f;
-  powerUp.color = powerUpConfig.color;
-  powerUp.bodyType = GAME_OBJECT_BODY_DESTROYABLE;
-  powerUp.status = GAME_OBJECT_ALIVE;
-  powerUp.sprite = powerUpConfig.sprite;
-  return powerUp;
+    source = blurPostProcessorScene(postProcessor);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, renderState.bufferWidth, renderState.bufferHeight);
+  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  unsigned int shader = postProcessor.shaders[variant];
+  glUseProgram(shader);
+  glUniform1f(glGetUniformLocation(shader, "time"), renderState.time);
+  glUniform1i(glGetUniformLocation(shader, "scene"), 0);
+  glBindTexture(GL_TEXTURE_2D, source);
+  glDrawArrays(GL_TRIANGLES, 0, postProcessor.vertices.size());
+  postProcessor.stats.passes++;
+  glBindVertexArray(0);
 }
 
-PowerUpEffect createPowerUpEffect(PowerUpConfig& powerUpConfig)
+void printPostProcessorStats(PostProcessor& postProcessor)
 {
-  PowerUpEffect powerUpEffect = PowerUpEffect
+  if (postProcessor.stats.frames == 0)
   {
-    .type = powerUpConfig.type,
-    .ttl = powerUpConfig.ttl,
-    .status = POWER_UP_EFFECT_STATUS_ACTIVATE
-  };
-  return powerUpEffect;
+    return;
+  }
+  double frames = postProcessor.stats.frames;
+  std::cout << "POST_PROCESSOR:: bypassed frames: " << postProcessor.stats.bypassedFrames * 100.0 / frames
+            << "%, full-screen passes/frame: " << postProcessor.stats.passes / frames << std::endl;
 }
 
-void drawSprite(unsigned int shaderProgram, Sprite& sprite, EntityAttributes& attributes)
+StaticLayer createStaticLayer(RenderState& renderState)
 {
-  glUseProgram(shaderProgram);
-  glm::mat4 model = glm::mat4(1.0f);
-  model = glm::translate(model, glm::vec3(attributes.position, 1.0f));
-  glm::vec3 center = glm::vec3(attributes.size.x / 2.0, attributes.size.y / 2.0, 0.0f);
-  model = glm::translate(model, center);
-  model = glm::rotate(model, glm::radians(attributes.rotation), glm::vec3(0.0f, 0.0f, 1.0f));
-  model = glm::translate(model, -center);
-  model = glm::scale(model, glm::vec3(attributes.size, 1.0f));
-  glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-  glUniform3fv(glGetUniformLocation(shaderProgram, "color"), 1, glm::value_ptr(attributes.color));
-  glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, sprite.texture.id);
-  glBindVertexArray(sprite.vao);
-  glDrawArrays(GL_TRIANGLES, 0, sprite.vertices.size());
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glBindVertexArray(0);
+  return StaticLayer
+  { .target = createPostProcessorTarget(renderState.bufferWidth, renderState.bufferHeight),
+    .config = nullptr,
+    .restores = 0,
+    .drawnBricks = 0,
+    .stats = StaticLayerStats { .frames = 0, .fullRedraws = 0, .tileRedraws = 0 }
+  };
 }
 
-void drawParticles(unsigned int shaderProgram, Particle& particle, std::vector<ParticleObject>& particleObjects)
+void printStaticLayerStats(StaticLayer& layer)
 {
-  glUseProgram(shaderProgram);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-  glBindVertexArray(particle.vao);
-  glBindBuffer(GL_ARRAY_BUFFER, particle.instanceVbo);
-  std::vector<ParticleIntanceVertex> vertices = {};
-  for (ParticleObject& particleObject : particleObjects)
+  if (layer.stats.frames == 0)
   {
-    if (particleObject.life > 0.0f)
-    {
-      ParticleIntanceVertex vertex = ParticleIntanceVertex
-      { .offset = particleObject.position,
-        .color = particleObject.color
-      };
-      vertices.push_back(vertex);
-    }
+    return;
   }
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(ParticleIntanceVertex), &vertices[0], GL_STATIC_DRAW);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleIntanceVertex), (void*)(offsetof(ParticleIntanceVertex, offset)));
+  std::cout << "STATIC_LAYER:: full redraws: " << layer.stats.fullRedraws
+            << ", tile redraws/frame: " << layer.stats.tileRedraws / (double)layer.stats.frames << std::endl;
+}
+
+SpriteBatch createSpriteBatch(unsigned int shaderProgram)
+{
+  std::vector<SpriteVertex> vertices =
+  {
+    SpriteVertex { glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, 1.0f) },
+    SpriteVertex { glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 0.0f) },
+    SpriteVertex { glm::vec2(0.0f, 0.0f), glm::vec2(0.0f, 0.0f) },
+    SpriteVertex { glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, 1.0f) },
+    SpriteVertex { glm::vec2(1.0f, 1.0f), glm::vec2(1.0f, 1.0f) },
+    SpriteVertex { glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 0.0f) },
+  };
+  SpriteBatch batch =
+  { .shader = shaderProgram,
+    .projectionLocation = glGetUniformLocation(shaderProgram, "projection"),
+    .textureLocation = glGetUniformLocation(shaderProgram, "texture1"),
+    .vertices = vertices,
+    .instanceCapacity = 1024,
+    .groups = {},
+    .instances = {},
+    .stats = SpriteBatchStats { .frames = 0, .sprites = 0, .drawCalls = 0 }
+  };
+  glGenVertexArrays(1, &batch.vao);
+  glBindVertexArray(batch.vao);
+  glGenBuffers(1, &batch.vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+  glBufferData(GL_ARRAY_BUFFER, batch.vertices.size() * sizeof(SpriteVertex), &batch.vertices[0], GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(offsetof(SpriteVertex, position)));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(offsetof(SpriteVertex, textureCoordinate)));
+  glEnableVertexAttribArray(1);
+  glGenBuffers(1, &batch.instanceVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, batch.instanceVbo);
+  glBufferData(GL_ARRAY_BUFFER, batch.instanceCapacity * sizeof(SpriteInstance), NULL, GL_STREAM_DRAW);
   glEnableVertexAttribArray(2);
   glVertexAttribDivisor(2, 1);
-  glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleIntanceVertex), (void*)(offsetof(ParticleIntanceVertex, color)));
   glEnableVertexAttribArray(3);
   glVertexAttribDivisor(3, 1);
-  glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, particle.texture.id);
-  glBindVertexArray(particle.vao);
-  glDrawArraysInstanced(GL_TRIANGLES, 0, particle.vertices.size(), vertices.size());
-  glBindTexture(GL_TEXTURE_2D, 0);
+  glEnableVertexAttribArray(4);
+  glVertexAttribDivisor(4, 1);
+  glEnableVertexAttribArray(5);
+  glVertexAttribDivisor(5, 1);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  batch.instances.reserve(batch.instanceCapacity);
+  return batch;
 }
 
-void drawBackground(unsigned int shaderProgram, int width, int height, Sprite& background)
+void pushSprite(SpriteBatch& batch, SpriteLayer layer, Sprite& sprite, EntityAttributes& attributes)
 {
-  EntityAttributes spriteAttribute = 
-  {
-    .position = glm::vec2(0.0f, 0.0f),
-    .size = glm::vec2(width, height),
-    .rotation = 0.0f,
-    .color = glm::vec3(1.0f),
+  SpriteInstance instance =
+  { .rect = glm::vec4(attributes.position, attributes.size),
+    .rotation = attributes.rotation,
+    .color = attributes.color,
+    .textureRect = sprite.textureRect
   };
-  drawSprite(shaderProgram, background, spriteAttribute);
-}
-
-void drawGameObject(unsigned int shaderProgram, GameObject& gameObject)
-{
-  if (gameObject.status == GAME_OBJECT_ALIVE)
+  for (SpriteBatchGroup& group : batch.groups)
   {
-    EntityAttributes spriteAttribute = 
+    if (group.layer == layer)
     {
-      .position = gameObject.position,
-      .size = gameObject.size,
-      .rotation = gameObject.rotation,
-      .color = gameObject.color,
-    };
-    drawSprite(shaderProgram, gameObject.sprite, spriteAttribute);
+      group.instances.push_back(instance);
+      return;
+    }
   }
+  batch.groups.push_back(SpriteBatchGroup
+  { .layer = layer,
+    .offset = 0,
+    .instances = { instance }
+  });
 }
 
-void drawGameLevel(RenderState& renderState, GameLevel& gameLevel)
+// draws every pushed sprite with one instanced draw call per layer, layers are drawn back to front; the sprites all
+// sample the atlas, which the caller has bound to unit 0
+void flushSpriteBatch(SpriteBatch& batch, glm::mat4& projection)
 {
-  glBindFramebuffer(GL_FRAMEBUFFER, gameLevel.postProcessor.fbo);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glClear(GL_COLOR_BUFFER_BIT);
-  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-  glUseProgram(gameLevel.config.spriteShader);
-  glUniformMatrix4fv(glGetUniformLocation(gameLevel.config.spriteShader, "projection"), 1, GL_FALSE, glm::value_ptr(gameLevel.map.projection));
-  glUseProgram(gameLevel.config.particleShader);
-  glUniformMatrix4fv(glGetUniformLocation(gameLevel.config.particleShader, "projection"), 1, GL_FALSE, glm::value_ptr(gameLevel.map.projection));
-  drawBackground(gameLevel.config.spriteShader, gameLevel.map.width, gameLevel.map.height, gameLevel.map.background);
-  for (GameObject& brick : gameLevel.map.bricks)
-  {
-    drawGameObject(gameLevel.config.spriteShader, brick);
+  std::sort(batch.groups.begin(), batch.groups.end(), [](const SpriteBatchGroup& a, const SpriteBatchGroup& b)
+  {
+    return a.layer < b.layer;
+  });
+  batch.instances.clear();
+  for (SpriteBatchGroup& group : batch.groups)
+  {
+    group.offset = batch.instances.size();
+    batch.instances.insert(batch.instances.end(), group.instances.begin(), group.instances.end());
   }
-  for (PowerUpObject& powerUp : gameLevel.powerUps)
+  if (batch.instances.empty())
   {
-    drawGameObject(gameLevel.config.spriteShader, powerUp);
+    return;
   }
-  drawGameObject(gameLevel.config.spriteShader, gameLevel.player);
-  drawParticles(gameLevel.config.particleShader, gameLevel.ball.particleModel, gameLevel.ball.particles);
-  drawGameObject(gameLevel.config.spriteShader, gameLevel.ball);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-  glDisable(GL_DEPTH_TEST);
-  glClear(GL_COLOR_BUFFER_BIT);
-  glUseProgram(gameLevel.config.postProcessorShader);
-  glUniform1f(glGetUniformLocation(gameLevel.config.postProcessorShader, "time"), renderState.time);
-  glUniform1i(glGetUniformLocation(gameLevel.config.postProcessorShader, "confuse"), gameLevel.postProcessor.confuse);
-  glUniform1i(glGetUniformLocation(gameLevel.config.postProcessorShader, "chaos"), gameLevel.postProcessor.chaos);
-  glUniform1i(glGetUniformLocation(gameLevel.config.postProcessorShader, "shake"), gameLevel.postProcessor.shake);
-  glUniform2fv(glGetUniformLocation(gameLevel.config.postProcessorShader, "offsets"), 9, (float*)gameLevel.postProcessor.offsets);
-  glUniform1iv(glGetUniformLocation(gameLevel.config.postProcessorShader, "edgeKernel"), 9, gameLevel.postProcessor.edgeKernel);
-  glUniform1fv(glGetUniformLocation(gameLevel.config.postProcessorShader, "blurKernel"), 9, gameLevel.postProcessor.blurKernel);
-  glBindVertexArray(gameLevel.postProcessor.vao);
-  glUniform1i(glGetUniformLocation(gameLevel.config.postProcessorShader, "scene"), 0);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, gameLevel.postProcessor.tid);
-  glDrawArrays(GL_TRIANGLES, 0, gameLevel.postProcessor.vertices.size());
-}
-
-void drawGameState(RenderState& renderState, GameState& gameState)
-{
-  GameLevel& gameLevel = gameState.levels[gameState.level];
-  if (gameState.status == GAME_ACTIVE)
-  {
-    drawGameLevel(renderState, gameLevel);
+  glUseProgram(batch.shader);
+  glUniformMatrix4fv(batch.projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+  glUniform1i(batch.textureLocation, 0);
+  glBindVertexArray(batch.vao);
+  glBindBuffer(GL_ARRAY_BUFFER, batch.instanceVbo);
+  if (batch.instances.size() > batch.instanceCapacity)
+  {
+    batch.instanceCapacity = std::max((unsigned int)batch.instances.size(), batch.instanceCapacity * 2);
   }
-}
-
-std::vector<std::vector<unsigned int>> loadTileData(std::filesystem::path path)
-{
-  std::vector<std::vector<unsigned int>> tileGrid;
-  unsigned int tileCode;
-  std::string line;
-  std::ifstream file;
-  file.open(path);
-  while (std::getline(file, line))
+  // orphan the previous storage so the upload does not wait on draws still reading it
+  glBufferData(GL_ARRAY_BUFFER, batch.instanceCapacity * sizeof(SpriteInstance), NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, batch.instances.size() * sizeof(SpriteInstance), &batch.instances[0]);
+  for (SpriteBatchGroup& group : batch.groups)
   {
-    std::istringstream content(line);
-    std::vector<unsigned int> tileRow;
-    while (content >> tileCode)
+    if (group.instances.empty())
     {
-      tileRow.push_back(tileCode);
+      continue;
     }
-    tileGrid.push_back(tileRow);
+    // GL 3.3 has no base instance, so the instance attributes are re-pointed at the group's slice of the buffer
+    size_t offset = group.offset * sizeof(SpriteInstance);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, rect)));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, rotation)));
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, color)));
+    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, textureRect)));
+    glDrawArraysInstanced(GL_TRIANGLES, 0, batch.vertices.size(), group.instances.size());
+    batch.stats.sprites += group.instances.size();
+    batch.stats.drawCalls++;
+    group.instances.clear();
   }
-  return tileGrid;
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
 }
 
-Tile createTile(unsigned int tileData)
+void printSpriteBatchStats(SpriteBatch& batch)
 {
-  Tile tile;
-  if (tileData == 1)
+  if (batch.stats.frames == 0)
   {
-    tile.type = TILE_TYPE_SOLID;
-    tile.color = glm::vec3(0.8f, 0.8f, 0.7f);
+    return;
   }
-  else if (tileData > 1)
+  double frames = batch.stats.frames;
+  std::cout << "SPRITE_BATCH:: sprites/frame: " << batch.stats.sprites / frames
+            << ", draw calls/frame: " << batch.stats.drawCalls / frames
+            << ", draw calls saved/frame: " << (batch.stats.sprites - batch.stats.drawCalls) / frames << std::endl;
+}
+
+// the live particles are packed at the front of the field, so they are written straight into the mapped buffer;
+// invalidating the whole buffer orphans the storage the previous frame may still be drawing from, which is what
+// makes the unsynchronized write safe without a fence
+void drawParticles(unsigned int shaderProgram, Particle& particle, ParticleField& field)
+{
+  if (field.count == 0)
   {
-    tile.type = TILE_TYPE_DESTROYABLE;
-    if (tileData == 2)
-    {
-      tile.color = glm::vec3(0.2f, 0.6f, 1.0f);
-    }
-    else if (tileData == 3)
-    {
-      tile.color = glm::vec3(0.0f, 0.7f, 0.0f);
-    }
-    else if (tileData == 4)
-    {
-      tile.color = glm::vec3(0.8f, 0.8f, 0.4f);
-    }
-    else if (tileData == 5)
-    {
-      tile.color = glm::vec3(1.0f, 0.5f, 0.0f);
-    }
+    return;
   }
-  else
+  glUseProgram(shaderProgram);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+  glBindVertexArray(particle.vao);
+  glBindBuffer(GL_ARRAY_BUFFER, particle.instanceVbo);
+  if (field.count > particle.instanceCapacity)
   {
-    tile.type = TILE_TYPE_EMPTY;
-    tile.color = glm::vec3(1.0f, 1.0f, 1.0f);
+    particle.instanceCapacity = std::max(field.count, particle.instanceCapacity * 2);
+    glBufferData(GL_ARRAY_BUFFER, particle.instanceCapacity * sizeof(ParticleIntanceVertex), NULL, GL_STREAM_DRAW);
   }
-  return tile;
-}
-
-TileMap createTileMap(std::vector<std::vector<unsigned int>> tileData)
-{
-  TileMap tileMap = { .grid = {} };
-  for (std::vector<unsigned int>& tileRow : tileData)
+  ParticleIntanceVertex* vertices = (ParticleIntanceVertex*)glMapBufferRange(
+    GL_ARRAY_BUFFER,
+    0,
+    field.count * sizeof(ParticleIntanceVertex),
+    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+  );
+  for (unsigned int i = 0; i < field.count; i++)
   {
-    std::vector<Tile> tileMapRow = {};
-    for (unsigned int tileColumn : tileRow)
-    {
-      tileMapRow.push_back(createTile(tileColumn));
-    }
-    tileMap.grid.push_back(tileMapRow);
+    vertices[i] = ParticleIntanceVertex
+    { .offset = glm::vec2(field.positionX[i], field.positionY[i]),
+      .color = glm::vec4(field.red[i], field.green[i], field.blue[i], field.alpha[i])
+    };
   }
-  return tileMap;
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
+  glUniform4fv(glGetUniformLocation(shaderProgram, "textureRect"), 1, glm::value_ptr(particle.textureRect));
+  glDrawArraysInstanced(GL_TRIANGLES, 0, particle.vertices.size(), field.count);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-GameLevelMap createGameLevelMap(GameLevelConfig gameLevelConfig)
+// the only per-frame upload is the handful of particles the balls spawned since the last frame, the ring is stepped
+// on the gpu by the time the simulation advanced and the spawn queue is emptied
+void updateGpuParticles(GpuParticles& gpuParticles, BallTrail& trail)
 {
-  GameLevelMap gameLevelMap =
-  {
-    .width = gameLevelConfig.width,
-    .height = gameLevelConfig.height,
-    .background = gameLevelConfig.background,
-    .projection = glm::ortho(0.0f, (float)gameLevelConfig.width, (float)gameLevelConfig.height, 0.0f),
-    .bricks = {},
-  };
-  unsigned int width = gameLevelConfig.tileMap.grid[0].size();
-  unsigned int height = gameLevelConfig.tileMap.grid.size();
-  float blockWidth = gameLevelMap.width / (float)width;
-  float blockHeight = (gameLevelMap.height / 2.0f) / (float)height;
-  for (unsigned int y = 0; y < height; y++)
+  ParticleField& spawns = trail.particles;
+  unsigned int spawnCount = std::min(spawns.count, gpuParticles.capacity);
+  if (spawnCount > 0)
   {
-    for (unsigned int x = 0; x < gameLevelConfig.tileMap.grid[y].size(); x++)
+    glBindBuffer(GL_TEXTURE_BUFFER, gpuParticles.spawnBuffer);
+    glm::vec4* texels = (glm::vec4*)glMapBufferRange(
+      GL_TEXTURE_BUFFER,
+      0,
+      spawnCount * 3 * sizeof(glm::vec4),
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+    );
+    for (unsigned int i = 0; i < spawnCount; i++)
     {
-      Tile tile = gameLevelConfig.tileMap.grid[y][x];
-      glm::vec2 size(blockWidth, blockHeight);
-      glm::vec2 position = size * glm::vec2(x, y);
-      if (tile.type == TILE_TYPE_SOLID)
-      {
-        GameObject brick;
-        brick.position = position;
-        brick.size = size;
-        brick.rotation = 0.0f;
-        brick.color = tile.color;
-        brick.bodyType = GAME_OBJECT_BODY_SOLID;
-        brick.status = GAME_OBJECT_ALIVE;
-        brick.sprite = gameLevelConfig.blockSolid;
-        gameLevelMap.bricks.push_back(brick);
-      }
-      else if (tile.type == TILE_TYPE_DESTROYABLE)
-      {
-        GameObject brick;
-        brick.position = position;
-        brick.size = size;
-        brick.rotation = 0.0f;
-        brick.color = tile.color;
-        brick.bodyType = GAME_OBJECT_BODY_DESTROYABLE;
-        brick.status = GAME_OBJECT_ALIVE;
-        brick.sprite = gameLevelConfig.blockDestroyable;
-        gameLevelMap.bricks.push_back(brick);
-      }
+      texels[i * 3] = glm::vec4(spawns.positionX[i], spawns.positionY[i], spawns.velocityX[i], spawns.velocityY[i]);
+      texels[i * 3 + 1] = glm::vec4(spawns.red[i], spawns.green[i], spawns.blue[i], spawns.alpha[i]);
+      texels[i * 3 + 2] = glm::vec4(spawns.life[i], trail.spawnTimes[i], 0.0f, 0.0f);
     }
+    glUnmapBuffer(GL_TEXTURE_BUFFER);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
   }
-  return gameLevelMap;
-}
-
-BallObject createBallObject(GameLevelMap& gameLevelMap, BallConfig& ballConfig, PlayerObject& playerObject) 
-{
-  BallObject ball;
-  ball.particles = {};
-  for (unsigned int i = 0; i < ballConfig.particleCount; i++)
-  {
-    ParticleObject particle = ParticleObject
-      { .position = glm::vec2(0.0f),
-        .velocity = glm::vec2(0.0f),
-        .color = glm::vec4(0.0f),
-        .life = 0.0f
-      };
-    ball.particles.push_back(particle);
-  }
-  ball.particleModel = ballConfig.particleModel;
-  ball.speed = ballConfig.speed;
-  ball.surfaceType = BALL_OBJECT_SURFACE_STICKY;
-  ball.radius = ballConfig.radius;
-  ball.velocity = glm::vec2(0.0f);
-  ball.size = glm::vec2(ballConfig.radius * 2.0f);
-  ball.position = playerObject.position + glm::vec2(playerObject.size.x / 2.0f - ball.radius, -ball.radius * 2.0f);
-  ball.rotation = 0.0f;
-  ball.color = ballConfig.color;
-  ball.bodyType = GAME_OBJECT_BODY_SOLID;
-  ball.status = GAME_OBJECT_ALIVE;
-  ball.sprite = ballConfig.sprite;
-  return ball;
-}
-
-PlayerObject createPlayerObject(GameLevelMap& gameLevelMap, PlayerConfig& playerConfig)
-{
-  PlayerObject player;
-  player.velocity = playerConfig.velocity;
-  player.position = glm::vec2(std::max(gameLevelMap.width / 2.0f - playerConfig.size.x / 2.0f, 0.0f), gameLevelMap.height - playerConfig.size.y);
-  player.size = playerConfig.size;
-  player.rotation = 0.0f;
-  player.color = playerConfig.color;
-  player.bodyType = GAME_OBJECT_BODY_SOLID;
-  player.status = GAME_OBJECT_ALIVE;
-  player.sprite = playerConfig.sprite;
-  return player;
-}
-
-GameLevel createGameLevel(RenderState renderState, GameLevelConfig config)
-{
-  GameLevelMap gameLevelMap = createGameLevelMap(config);
-  PlayerObject playerObject = createPlayerObject(gameLevelMap, config.playerConfig);
-  BallObject ballObject = createBallObject(gameLevelMap, config.ballConfig, playerObject);
-  PostProcessor postProcessor = createPostProcessor(renderState);
-  ShakeEffect shakeEffect = ShakeEffect { .ttl = 0.0f };
-  GameLevel level =
-  { .map = gameLevelMap,
-    .player = playerObject,
-    .ball = ballObject,
-    .config = config,
-    .postProcessor = postProcessor,
-    .shakeEffect = shakeEffect,
-    .powerUps = {},
-  };
-  return level;
-}
-
-AabbCollisionBox gameObjectToAabbCollisionBox(GameObject& gameObject)
-{
-  return AabbCollisionBox
-  { .topLeft = gameObject.position,
-    .bottomRight = gameObject.position + gameObject.size
-  };
+  unsigned int shader = gpuParticles.updateShader;
+  glUseProgram(shader);
+  glUniform1i(glGetUniformLocation(shader, "spawns"), 1);
+  glUniform1i(glGetUniformLocation(shader, "spawnStart"), gpuParticles.spawnCursor);
+  glUniform1i(glGetUniformLocation(shader, "spawnCount"), spawnCount);
+  glUniform1i(glGetUniformLocation(shader, "capacity"), gpuParticles.capacity);
+  glUniform1f(glGetUniformLocation(shader, "deltaTime"), trail.particleTime);
+  glUniform1f(glGetUniformLocation(shader, "fadeRate"), BALL_PARTICLE_FADE_RATE);
+  // unit 0 holds the atlas for the rest of the frame, the spawns are read through unit 1
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_BUFFER, gpuParticles.spawnTexture);
+  glEnable(GL_RASTERIZER_DISCARD);
+  glBindVertexArray(gpuParticles.updateVaos[gpuParticles.current]);
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, gpuParticles.buffers[1 - gpuParticles.current]);
+  glBeginTransformFeedback(GL_POINTS);
+  glDrawArrays(GL_POINTS, 0, gpuParticles.capacity);
+  glEndTransformFeedback();
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+  glBindVertexArray(0);
+  glDisable(GL_RASTERIZER_DISCARD);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glActiveTexture(GL_TEXTURE0);
+  gpuParticles.current = 1 - gpuParticles.current;
+  gpuParticles.spawnCursor = (gpuParticles.spawnCursor + spawnCount) % gpuParticles.capacity;
+  spawns.count = 0;
+  trail.particleTime = 0.0f;
 }
 
-AabbCollisionCircle ballObjectToAabbCollisionCircle(BallObject& ballObject)
+void drawGpuParticles(unsigned int shaderProgram, Particle& particle, GpuParticles& gpuParticles)
 {
-  return AabbCollisionCircle
-  { .radius = ballObject.radius,
-    .center = ballObject.position + glm::vec2(ballObject.radius)
-  };
+  glUseProgram(shaderProgram);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+  glBindVertexArray(gpuParticles.drawVaos[gpuParticles.current]);
+  glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
+  glUniform4fv(glGetUniformLocation(shaderProgram, "textureRect"), 1, glm::value_ptr(particle.textureRect));
+  glDrawArraysInstanced(GL_TRIANGLES, 0, particle.vertices.size(), gpuParticles.capacity);
+  glBindVertexArray(0);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-void handleBallObjectMovement(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
+void pushBackground(SpriteBatch& batch, int width, int height, Sprite& background)
 {
-  gameLevel.ball.position += renderState.deltaTime * gameLevel.ball.velocity;
-  if (gameLevel.ball.position.x <= 0.0f)
-  {
-    gameLevel.ball.velocity.x *= -1.0f;
-    gameLevel.ball.position.x = 0;
-  }
-  else if (gameLevel.ball.position.x + gameLevel.ball.size.x >= gameLevel.map.width)
-  {
-    gameLevel.ball.velocity.x *= -1.0f;
-    gameLevel.ball.position.x = gameLevel.map.width - gameLevel.ball.size.x;
-  }
-  else if (gameLevel.ball.position.y <= 0.0f)
-  {
-    gameLevel.ball.velocity.y *= -1.0f;
-    gameLevel.ball.position.y = 0;
-  }
-  else if (gameLevel.ball.position.y + gameLevel.ball.size.y >= gameLevel.map.height)
+  EntityAttributes spriteAttribute = 
   {
-    // game over
-    gameLevel = createGameLevel(renderState, gameLevel.config);
-  }
-}
-
-void respawnBallObjectParticle(BallObject& ballObject, ParticleObject& particle)
-{
-  glm::vec2 offset = glm::vec2(ballObject.radius / 2.0f);
-  float random = ((rand() % 100) - 50) / 10.0f;
-  float rColor = 0.5f + ((rand() % 100) / 100.0f);
-  particle.position = ballObject.position + random + offset;
-  particle.color = glm::vec4(rColor, rColor, rColor, 1.0f);
-  particle.life = 1.0f;
-  particle.velocity = ballObject.velocity * 0.1f;
+    .position = glm::vec2(0.0f, 0.0f),
+    .size = glm::vec2(width, height),
+    .rotation = 0.0f,
+    .color = glm::vec3(1.0f),
+  };
+  pushSprite(batch, SPRITE_LAYER_BACKGROUND, background, spriteAttribute);
 }
 
-void handleBallObjectParticles(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
+void pushGameObject(SpriteBatch& batch, SpriteLayer layer, Sprite& sprite, GameObject& gameObject)
 {
-  for (unsigned int i = 0; i < 2; i++)
-  {
-    for (ParticleObject& particle : gameLevel.ball.particles)
-    {
-      if (particle.life <= 0.0f)
-      {
-        respawnBallObjectParticle(gameLevel.ball, particle);
-        break;
-      }
-    }
-  }
-  for (ParticleObject& particle : gameLevel.ball.particles)
+  if (gameObject.status == GAME_OBJECT_ALIVE)
   {
-    particle.life -= renderState.deltaTime;
-    if (particle.life > 0.0f)
+    EntityAttributes spriteAttribute = 
     {
-      particle.position -= particle.velocity * renderState.deltaTime;
-      particle.color.a -= renderState.deltaTime * 2.5f;
-    }
+      .position = gameObject.position,
+      .size = gameObject.size,
+      .rotation = gameObject.rotation,
+      .color = gameObject.color,
+    };
+    pushSprite(batch, layer, sprite, spriteAttribute);
   }
 }
 
-Direction directionFromTarget(glm::vec2 target)
+void pushBalls(SpriteBatch& batch, Sprite& sprite, BallField& balls, float interpolation)
 {
-  glm::vec2 normalized = glm::normalize(target);
-  std::vector<std::tuple<Direction, glm::vec2>> directionByPositions = {
-    {DIRECTION_UP, glm::vec2(0.0f,  1.0f)}, // up
-    {DIRECTION_RIGHT, glm::vec2(1.0f,  0.0f)}, // right
-    {DIRECTION_DOWN, glm::vec2(0.0f, -1.0f)}, // down
-    {DIRECTION_LEFT, glm::vec2(-1.0f, 0.0f)}  // left
-  };
-  float max = 0.0f;
-  Direction bestMatch = DIRECTION_UP;
-  for (std::tuple<Direction, glm::vec2>& directionByPosition: directionByPositions)
+  glm::vec2 size = glm::vec2(balls.radius * 2.0f);
+  for (unsigned int i = 0; i < balls.count; i++)
   {
-    float scale = glm::dot(normalized, std::get<1>(directionByPosition));
-    if (scale > max)
+    EntityAttributes spriteAttribute =
     {
-        max = scale;
-        bestMatch = std::get<0>(directionByPosition);
-    }
-  }
-  return bestMatch;
-}
-
-std::optional<Collision> checkCircleToBoxCollision(AabbCollisionCircle circle, AabbCollisionBox box)
-{
-  glm::vec2 halfExtent = (box.bottomRight - box.topLeft) / 2.0f;
-  glm::vec2 center = box.topLeft + halfExtent;
-  glm::vec2 closest = center + glm::clamp(circle.center - center, -halfExtent, halfExtent);
-  glm::vec2 difference = closest - circle.center;
-  if (glm::length(difference) > circle.radius)
-  {
-    return {};
-  }
-  return Collision
-  { .direction = directionFromTarget(difference),
-    .difference = difference
-  };
-}
-
-std::optional<Collision> checkBoxToBoxCollision(AabbCollisionBox boxA, AabbCollisionBox boxB)
-{
-  bool collisionX = boxB.topLeft.x <= boxA.bottomRight.x && boxA.topLeft.x <= boxB.bottomRight.x;
-  bool collisionY = boxB.topLeft.y <= boxA.bottomRight.y && boxA.topLeft.y <= boxB.bottomRight.y;
-  if (collisionX && collisionY)
-  {
-    glm::vec2 difference = glm::vec2((boxA.topLeft + boxA.bottomRight) - (boxB.topLeft + boxB.bottomRight));
-    return Collision
-    { .direction = directionFromTarget(difference),
-      .difference = difference
+      .position = glm::mix(balls.previousPosition[i], balls.position[i], interpolation),
+      .size = size,
+      .rotation = 0.0f,
+      .color = balls.color,
     };
+    pushSprite(batch, SPRITE_LAYER_OBJECTS, sprite, spriteAttribute);
   }
-  return {};
 }
 
-void spawnPowerUp(PowerUpConfig& config, glm::vec2 position, GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
+void pushPlayer(SpriteBatch& batch, Sprite& sprite, PlayerObject& player, float interpolation)
 {
-  if ((rand() % config.chance) == 0)
+  EntityAttributes spriteAttribute =
   {
-    gameLevel.powerUps.push_back(createPowerUp(config, position));
-  }
+    .position = glm::vec2(glm::mix(player.previousX, player.position.x, interpolation), player.position.y),
+    .size = player.size,
+    .rotation = player.rotation,
+    .color = player.color,
+  };
+  pushSprite(batch, SPRITE_LAYER_OBJECTS, sprite, spriteAttribute);
 }
 
-void spawnPowerUps(glm::vec2 position, GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
+// power ups fall at a constant velocity, so where one was a fraction of a step ago needs no stored position
+void pushPowerUp(SpriteBatch& batch, Sprite& sprite, const PowerUpConfig& config, PowerUpObject& powerUp, float stepsAgo, float timestep)
 {
-  for (PowerUpConfig& config : gameLevel.config.powerUpConfigs)
+  EntityAttributes spriteAttribute =
   {
-    spawnPowerUp(config, position, window, renderState, gameLevel);
-  }
+    .position = powerUp.position - stepsAgo * timestep * powerUp.velocity,
+    .size = powerUp.size,
+    .rotation = 0.0f,
+    .color = config.color,
+  };
+  pushSprite(batch, SPRITE_LAYER_OBJECTS, sprite, spriteAttribute);
 }
 
-void activatePowerUp(PowerUpEffect& powerUp, GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
-{
-  switch (powerUp.type)
-  {
-    case POWER_UP_SPEED:
-    {
-      gameLevel.player.velocity *= 1.2f;
-      break;
-    }
-    case POWER_UP_STICKY:
-    {
-      gameLevel.ball.surfaceType = BALL_OBJECT_SURFACE_STICKY;
-      gameLevel.ball.color = glm::vec3(1.0f, 0.5f, 1.0f);
-      break;
-    }
-    case POWER_UP_PASS_THROUGH:
-    {
-      gameLevel.ball.collisionType = BALL_OBJECT_COLLISION_PASS_THROUGH;
-      gameLevel.ball.color = glm::vec3(1.0f, 0.5f, 0.5f);
-      break;
-    }
-    case POWER_UP_PADDLE_SIZE_UP:
-    {
-      gameLevel.player.size.x += 50.0f;
-      break;
-    }
-    case POWER_UP_CONFUSION:
-    {
-      gameLevel.postProcessor.confuse = true;
-      break;
-    }
-    case POWER_UP_CHAOS:
+// a destroyed brick's tile, widened to whole pixels of the layer; the background and every live brick touching the widened
+// rectangle are drawn again inside it, so the neighbours' edges the rounding takes in come back as they were
+void redrawStaticLayerTile(Renderer& renderer, GameLevel& gameLevel, GameObject& brick)
+{
+  const GameLevelConfig& config = *gameLevel.config;
+  ResourceTable<Sprite>& sprites = renderer.resources.sprites;
+  PostProcessorTarget& target = renderer.staticLayer.target;
+  glm::vec2 scale = glm::vec2(target.width / (float)gameLevel.map.width, target.height / (float)gameLevel.map.height);
+  glm::vec2 minPixel = glm::floor(brick.position * scale);
+  glm::vec2 maxPixel = glm::ceil((brick.position + brick.size) * scale);
+  glScissor((int)minPixel.x, target.height - (int)maxPixel.y, (int)(maxPixel.x - minPixel.x), (int)(maxPixel.y - minPixel.y));
+  pushBackground(renderer.spriteBatch, gameLevel.map.width, gameLevel.map.height, getResource(sprites, config.background));
+  forEachBrickRangeInRegion(gameLevel.map.brickGrid, minPixel / scale, maxPixel / scale, [&](unsigned int first, unsigned int last)
+  {
+    for (unsigned int i = first; i <= last; i++)
     {
-      gameLevel.postProcessor.chaos = true;
-      break;
+      GameObject& neighbour = gameLevel.map.bricks[i];
+      SpriteHandle sprite = neighbour.bodyType == GAME_OBJECT_BODY_SOLID ? config.blockSolid : config.blockDestroyable;
+      pushGameObject(renderer.spriteBatch, SPRITE_LAYER_BRICKS, getResource(sprites, sprite), neighbour);
     }
-  }
+  });
+  flushSpriteBatch(renderer.spriteBatch, gameLevel.map.projection);
 }
 
-void deactivatePowerUp(PowerUpEffect& powerUp, GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
+// brings the layer up to date with the level, the atlas has to be bound to unit 0 and blending enabled
+void updateStaticLayer(RenderState& renderState, Renderer& renderer, GameLevel& gameLevel)
 {
-  switch (powerUp.type)
+  StaticLayer& layer = renderer.staticLayer;
+  GameLevelMap& map = gameLevel.map;
+  layer.stats.frames++;
+  if (layer.target.width != renderState.bufferWidth || layer.target.height != renderState.bufferHeight)
   {
-    case POWER_UP_SPEED:
-    {
-      gameLevel.player.velocity = gameLevel.config.playerConfig.velocity;
-      break;
-    }
-    case POWER_UP_STICKY:
-    {
-      gameLevel.ball.surfaceType = BALL_OBJECT_SURFACE_REFLECT;
-      gameLevel.ball.color = gameLevel.config.ballConfig.color;
-      break;
-    }
-    case POWER_UP_PASS_THROUGH:
-    {
-      gameLevel.ball.collisionType = BALL_OBJECT_COLLISION_DEFAULT;
-      gameLevel.ball.color = gameLevel.config.ballConfig.color;
-      break;
-    }
-    case POWER_UP_PADDLE_SIZE_UP:
-    {
-      gameLevel.player.size = gameLevel.config.playerConfig.size;
-      break;
-    }
-    case POWER_UP_CONFUSION:
-    {
-      gameLevel.postProcessor.confuse = false;
-      break;
-    }
-    case POWER_UP_CHAOS:
-    {
-      gameLevel.postProcessor.chaos = false;
-      break;
-    }
+    glDeleteFramebuffers(1, &layer.target.fbo);
+    glDeleteTextures(1, &layer.target.texture);
+    layer.target = createPostProcessorTarget(renderState.bufferWidth, renderState.bufferHeight);
+    layer.config = nullptr;
+    // creating the target unbinds the atlas
+    glBindTexture(GL_TEXTURE_2D, renderer.atlas.texture.id);
   }
-}
-
-void handleGameLevelBrickCollision(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
-{
-  AabbCollisionCircle ballCollisionCircle = ballObjectToAabbCollisionCircle(gameLevel.ball);
-  for (GameObject& brick : gameLevel.map.bricks)
+  bool redrawAll = layer.config != gameLevel.config || layer.restores != map.restores
+    || layer.drawnBricks > map.destroyedBricks.size() || map.destroyedBricks.size() - layer.drawnBricks > STATIC_LAYER_MAX_TILE_REDRAWS;
+  if (!redrawAll && layer.drawnBricks == map.destroyedBricks.size())
   {
-    if (brick.status != GAME_OBJECT_ALIVE)
-    {
-      continue;
-    }
-    std::optional<Collision> result = checkCircleToBoxCollision(
-      ballCollisionCircle,
-      gameObjectToAabbCollisionBox(brick)
-    );
-    if (!result.has_value())
-    {
-      continue;
-    }
-    Collision collision = result.value();
-    if (brick.bodyType == GAME_OBJECT_BODY_DESTROYABLE)
-    {
-      brick.status = GAME_OBJECT_DESTROYED;
-      spawnPowerUps(brick.position, window, renderState, gameLevel);
-    } else if (brick.bodyType == GAME_OBJECT_BODY_SOLID)
+    return;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, layer.target.fbo);
+  glViewport(0, 0, layer.target.width, layer.target.height);
+  if (redrawAll)
+  {
+    const GameLevelConfig& config = *gameLevel.config;
+    ResourceTable<Sprite>& sprites = renderer.resources.sprites;
+    Sprite& blockSolid = getResource(sprites, config.blockSolid);
+    Sprite& blockDestroyable = getResource(sprites, config.blockDestroyable);
+    pushBackground(renderer.spriteBatch, map.width, map.height, getResource(sprites, config.background));
+    for (GameObject& brick : map.bricks)
     {
-      if (gameLevel.ball.collisionType == BALL_OBJECT_COLLISION_PASS_THROUGH)
-      {
-        continue;
-      }
-      else
-      {
-        gameLevel.shakeEffect.ttl = gameLevel.config.shakeEffectConfig.duration;
-      }
+      pushGameObject(renderer.spriteBatch, SPRITE_LAYER_BRICKS, brick.bodyType == GAME_OBJECT_BODY_SOLID ? blockSolid : blockDestroyable, brick);
     }
-    if (collision.direction == DIRECTION_LEFT || collision.direction == DIRECTION_RIGHT)
+    flushSpriteBatch(renderer.spriteBatch, map.projection);
+    layer.stats.fullRedraws++;
+  }
+  else
+  {
+    glEnable(GL_SCISSOR_TEST);
+    for (unsigned int i = layer.drawnBricks; i < map.destroyedBricks.size(); i++)
     {
-      gameLevel.ball.velocity.x *= -1.0f;
-      float penetration = gameLevel.ball.radius - std::abs(collision.difference.x);
-      if (collision.direction == DIRECTION_LEFT)
-      {
-        gameLevel.ball.position.x += penetration;
-      }
-      else
-      {
-        gameLevel.ball.position.x -= penetration;
-      }
-    }
-    else if (collision.direction == DIRECTION_UP || collision.direction == DIRECTION_DOWN)
-    {
-      gameLevel.ball.velocity.y *= -1.0f;
-      float penetration = gameLevel.ball.radius - std::abs(collision.difference.y);
-      if (collision.direction == DIRECTION_UP)
-      {
-        gameLevel.ball.position.y -= penetration;
-      }
-      else
-      {
-        gameLevel.ball.position.y += penetration;
-      }
+      redrawStaticLayerTile(renderer, gameLevel, map.bricks[map.destroyedBricks[i]]);
+      layer.stats.tileRedraws++;
     }
+    glDisable(GL_SCISSOR_TEST);
   }
+  layer.config = gameLevel.config;
+  layer.restores = map.restores;
+  layer.drawnBricks = map.destroyedBricks.size();
 }
 
-void handleGameLevelPlayerCollision(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
-{
-  std::optional<Collision> result = checkCircleToBoxCollision(
-    ballObjectToAabbCollisionCircle(gameLevel.ball),
-    gameObjectToAabbCollisionBox(gameLevel.player)
-  );
-  if (!result.has_value())
-  {
-    return;
-  }
-  Collision collision = result.value();
-  if (collision.direction == DIRECTION_UP)
-  {
-    gameLevel.ball.position.y = gameLevel.player.position.y - gameLevel.ball.size.y;
-  }
-  else if (collision.direction == DIRECTION_DOWN)
+// the whole scene is drawn with the atlas bound once, the post-processor's scene texture is the only other binding;
+// without a live effect the scene goes straight to the window and the post-processor costs nothing
+void drawGameLevel(RenderState& renderState, Renderer& renderer, unsigned int forcedEffects, GameLevel& gameLevel)
+{
+  const GameLevelConfig& config = *gameLevel.config;
+  ResourceTable<Sprite>& sprites = renderer.resources.sprites;
+  Particle& ballParticle = getResource(renderer.resources.particles, config.ballConfig.particleModel);
+  unsigned int particleShader = getResource(renderer.resources.shaders, config.particleShader);
+  SpriteBatch& spriteBatch = renderer.spriteBatch;
+  PostProcessor& postProcessor = renderer.postProcessor;
+  unsigned int variant = postProcessorVariant(gameLevel.screenEffects, forcedEffects);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, renderer.atlas.texture.id);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  updateStaticLayer(renderState, renderer, gameLevel);
+  // the layer covers the whole target, so copying it in replaces clearing it
+  PostProcessorTarget& layer = renderer.staticLayer.target;
+  int width = variant == 0 ? renderState.bufferWidth : postProcessor.scene.width;
+  int height = variant == 0 ? renderState.bufferHeight : postProcessor.scene.height;
+  glBindFramebuffer(GL_FRAMEBUFFER, variant == 0 ? 0 : postProcessor.scene.fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, layer.fbo);
+  glBlitFramebuffer(0, 0, layer.width, layer.height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, variant == 0 ? 0 : postProcessor.scene.fbo);
+  glViewport(0, 0, width, height);
+  glUseProgram(particleShader);
+  glUniformMatrix4fv(glGetUniformLocation(particleShader, "projection"), 1, GL_FALSE, glm::value_ptr(gameLevel.map.projection));
+  for (unsigned int i = 0; i < gameLevel.powerUps.count; i++)
   {
-    gameLevel.ball.position.y = gameLevel.player.position.y + gameLevel.player.size.y;
+    PowerUpObject& powerUp = gameLevel.powerUps.items[i];
+    const PowerUpConfig& powerUpConfig = config.powerUpConfigs[powerUp.type];
+    pushPowerUp(spriteBatch, getResource(sprites, powerUpConfig.sprite), powerUpConfig, powerUp, 1.0f - renderState.interpolation, renderState.timestep);
   }
-  else if (collision.direction == DIRECTION_LEFT)
+  pushPlayer(spriteBatch, getResource(sprites, config.playerConfig.sprite), gameLevel.player, renderState.interpolation);
+  flushSpriteBatch(spriteBatch, gameLevel.map.projection);
+  // the particle trail sits between the paddle and the balls, so the balls go into a second flush
+  if (gameLevel.trail.particleBackend == PARTICLE_BACKEND_GPU)
   {
-    gameLevel.ball.position.x = gameLevel.player.position.x - gameLevel.ball.size.x;
+    updateGpuParticles(renderer.gpuParticles, gameLevel.trail);
+    drawGpuParticles(particleShader, ballParticle, renderer.gpuParticles);
   }
-  else if (collision.direction == DIRECTION_RIGHT)
+  else
   {
-    gameLevel.ball.position.x = gameLevel.player.position.x + gameLevel.player.size.x;
+    drawParticles(particleShader, ballParticle, gameLevel.trail.particles);
   }
-  if (gameLevel.ball.surfaceType == BALL_OBJECT_SURFACE_STICKY)
+  pushBalls(spriteBatch, getResource(sprites, config.ballConfig.sprite), gameLevel.balls, renderState.interpolation);
+  flushSpriteBatch(spriteBatch, gameLevel.map.projection);
+  spriteBatch.stats.frames++;
+  postProcessor.stats.frames++;
+  if (variant == 0)
   {
-    gameLevel.ball.velocity = glm::vec2(0.0f);
+    postProcessor.stats.bypassedFrames++;
   }
   else
   {
-    glm::vec2 half = gameLevel.player.size / 2.0f;
-    glm::vec2 center = gameLevel.player.position + half;
-    float distance = (gameLevel.ball.position.x + gameLevel.ball.radius) - center.x;
-    float percentage = distance / half.x;
-    float strength = 2.0f;
-    glm::vec2 velocity = gameLevel.ball.velocity;
-    gameLevel.ball.velocity.x = gameLevel.ball.speed * percentage * strength;
-    gameLevel.ball.velocity = glm::normalize(gameLevel.ball.velocity) * glm::length(velocity);
-    gameLevel.ball.velocity.y = -1.0f * abs(gameLevel.ball.velocity.y);
+    applyPostProcessor(renderState, postProcessor, variant);
   }
 }
 
-void handleGameLevelCollision(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
-{
-  handleGameLevelBrickCollision(window, renderState, gameLevel);
-  handleGameLevelPlayerCollision(window, renderState, gameLevel);
-}
-
-void movePlayerObject(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel, float travel)
+void drawGameState(RenderState& renderState, Renderer& renderer, GameSettings& settings, GameState& gameState)
 {
-  float x = gameLevel.player.position.x;
-  float maxX = std::max(0.0f, (float)gameLevel.map.width - gameLevel.player.size.x);
-  gameLevel.player.position.x += travel;
-  gameLevel.player.position.x = std::clamp(gameLevel.player.position.x, 0.0f, maxX);
-  if (gameLevel.ball.surfaceType != BALL_OBJECT_SURFACE_STICKY)
-  {
-    return;
-  }
-  std::optional<Collision> result = checkCircleToBoxCollision(
-    ballObjectToAabbCollisionCircle(gameLevel.ball),
-    gameObjectToAabbCollisionBox(gameLevel.player)
-  );
-  if (!result.has_value())
+  if (gameState.status == GAME_ACTIVE)
   {
-    return;
+    drawGameLevel(renderState, renderer, settings.effects, gameState.gameLevel);
   }
-  float xdiff = gameLevel.player.position.x - x;
-  Collision collision = result.value();
-  gameLevel.ball.position.x += xdiff;
 }
 
-void handlePlayerInput(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
+
+void updateRenderState(GLFWwindow* window, RenderState& state)
 {
-  float travel = gameLevel.player.velocity * renderState.deltaTime;
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-  {
-    movePlayerObject(window, renderState, gameLevel, travel * -1);
-  }
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  state.time = glfwGetTime();
+  state.deltaTime = state.time - state.lastFrame;
+  state.lastFrame = state.time;
+  glfwGetFramebufferSize(window, &state.bufferWidth, &state.bufferHeight);
+  if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
   {
-    movePlayerObject(window, renderState, gameLevel, travel);
-  }
-  if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
-  {
-    if (gameLevel.ball.surfaceType == BALL_OBJECT_SURFACE_STICKY) {
-      std::optional<Collision> result = checkCircleToBoxCollision(
-        ballObjectToAabbCollisionCircle(gameLevel.ball),
-        gameObjectToAabbCollisionBox(gameLevel.player)
-      );
-      if (result.has_value())
-      {
-        gameLevel.ball.surfaceType = BALL_OBJECT_SURFACE_REFLECT;
-        gameLevel.ball.velocity = gameLevel.ball.speed * glm::normalize(glm::vec2(1.0f));
-      }
-    }
+    glfwSetWindowShouldClose(window, GL_TRUE);
   }
 }
 
-void handleUpdatePowerUpObject(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
+GameInput readWindowInput(GLFWwindow* window)
 {
-  AabbCollisionBox playerCollisionBox = gameObjectToAabbCollisionBox(gameLevel.player);
-  for (auto i = gameLevel.powerUps.begin(); i != gameLevel.powerUps.end();)
-  {
-    PowerUpObject& powerUp = *i;
-    powerUp.position += renderState.deltaTime * powerUp.velocity;
-    if (powerUp.position.y + powerUp.size.y >= gameLevel.map.height)
-    {
-      i = gameLevel.powerUps.erase(i);
-      continue;
-    }
-    std::optional<Collision> result = checkBoxToBoxCollision(
-      gameObjectToAabbCollisionBox(powerUp),
-      playerCollisionBox
-    );
-    if (result.has_value())
-    {
-      for (PowerUpConfig& config : gameLevel.config.powerUpConfigs)
-      {
-        if (config.type != powerUp.type)
-        {
-          continue;
-        }
-        gameLevel.powerUpEffects.push_back(createPowerUpEffect(config));
-      }
-      i = gameLevel.powerUps.erase(i);
-      continue;
-    }
-    else
-    {
-      ++i;
-    }
-  }
+  return GameInput
+  { .left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS,
+    .right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS,
+    .launch = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS
+  };
 }
 
-void handleUpdatePowerUpEffect(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
-{
-  for (auto i = gameLevel.powerUpEffects.begin(); i != gameLevel.powerUpEffects.end();)
-  {
-    PowerUpEffect& powerUpEffect = *i;
-    if (powerUpEffect.status == POWER_UP_EFFECT_STATUS_DEACTIVATED)
-    {
-      i = gameLevel.powerUpEffects.erase(i);
-    }
+GameSettings readGameSettings(int argc, char** argv)
+{
+  GameSettings settings =
+  {
+    .particleBackend = PARTICLE_BACKEND_CPU,
+    .frames = 0,
+    .effects = 0,
+    .seed = 0,
+    .balls = 0,
+    .particleCount = BALL_PARTICLE_COUNT,
+    .recordPath = {},
+    .replayPath = {},
+    .tickRate = 60.0f,
+    .maxStepsPerFrame = 8,
+    .vsync = true,
+    .frameRate = 0.0f
+  };
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    std::string flag = argv[i];
+    std::string value = argv[i + 1];
+    if (flag == "--particles")
+      settings.particleBackend = value == "gpu" ? PARTICLE_BACKEND_GPU : PARTICLE_BACKEND_CPU;
+    else if (flag == "--frames")
+      settings.frames = std::stoul(value);
+    else if (flag == "--effects")
+      settings.effects = (value.find("chaos") != std::string::npos ? POST_PROCESSOR_CHAOS : 0)
+        | (value.find("confuse") != std::string::npos ? POST_PROCESSOR_CONFUSE : 0)
+        | (value.find("shake") != std::string::npos ? POST_PROCESSOR_SHAKE : 0);
+    else if (flag == "--seed")
+      settings.seed = std::stoull(value);
+    else if (flag == "--balls")
+      settings.balls = std::stoul(value);
+    else if (flag == "--particle-count")
+      settings.particleCount = std::max(1ul, std::stoul(value));
+    else if (flag == "--record")
+      settings.recordPath = value;
+    else if (flag == "--replay")
+      settings.replayPath = value;
+    else if (flag == "--tick-rate")
+      settings.tickRate = std::max(1.0f, std::stof(value));
+    else if (flag == "--max-steps")
+      settings.maxStepsPerFrame = std::max(1, std::stoi(value));
+    else if (flag == "--vsync")
+      settings.vsync = value != "0" && value != "off";
+    else if (flag == "--fps")
+      settings.frameRate = std::max(0.0f, std::stof(value));
     else
-    {
-      powerUpEffect.ttl = std::max(powerUpEffect.ttl - renderState.deltaTime, 0.0f);
-      if (powerUpEffect.status == POWER_UP_EFFECT_STATUS_ACTIVATED && powerUpEffect.ttl <= 0)
-      {
-        powerUpEffect.status = POWER_UP_EFFECT_STATUS_DEACTIVATE;
-      }
-      else if (powerUpEffect.status == POWER_UP_EFFECT_STATUS_ACTIVATE)
-      {
-        activatePowerUp(powerUpEffect, window, renderState, gameLevel);
-        powerUpEffect.status = POWER_UP_EFFECT_STATUS_ACTIVATED;
-      }
-      else if (powerUpEffect.status == POWER_UP_EFFECT_STATUS_DEACTIVATE)
-      {
-        deactivatePowerUp(powerUpEffect, window, renderState, gameLevel);
-        powerUpEffect.status = POWER_UP_EFFECT_STATUS_DEACTIVATED;
-      }
-      ++i;
-    }
+      std::cout << "Unknown flag: " << flag << std::endl;
   }
+  return settings;
 }
 
-void handleShakeEffect(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
+// what the level owns against the config it shares, the tiles behind a config are mapped from the level file
+void printGameLevelMemory(GameState& gameState)
 {
-  gameLevel.postProcessor.shake = gameLevel.shakeEffect.ttl > 0.0f;
-  gameLevel.shakeEffect.ttl = std::max(gameLevel.shakeEffect.ttl - renderState.deltaTime, 0.0f);
+  std::cout << "LEVEL:: " << gameState.level << ": " << measureGameLevelBytes(gameState.gameLevel) << " bytes owned, "
+            << measureGameLevelConfigBytes(*gameState.gameLevel.config) << " bytes of shared config" << std::endl;
 }
 
-void updateGameLevel(GLFWwindow* window, RenderState& renderState, GameLevel& gameLevel)
+void printLevelSequenceStats(LevelSequence& sequence)
 {
-  handlePlayerInput(window, renderState, gameLevel);
-  handleBallObjectMovement(window, renderState, gameLevel);
-  handleGameLevelCollision(window, renderState, gameLevel);
-  handleBallObjectParticles(window, renderState, gameLevel);
-  handleUpdatePowerUpObject(window, renderState, gameLevel);
-  handleUpdatePowerUpEffect(window, renderState, gameLevel);
-  handleShakeEffect(window, renderState, gameLevel);
+  std::cout << "LEVEL:: entered: " << sequence.entered << ", prefetched: " << sequence.prefetchHits
+            << ", wait ms/level: " << sequence.waitSeconds * 1000.0 / std::max(1u, sequence.entered) << std::endl;
 }
 
-void updateGameState(GLFWwindow* window, RenderState& renderState, GameState& gameState)
+// the finished level is dropped as the next one is moved in, recorded and replayed sessions stay on their one level
+void advanceGameLevel(GameState& gameState, LevelSequence& levelSequence)
 {
-  if (gameState.status == GAME_ACTIVE)
-  {
-    GameLevel& gameLevel = gameState.levels[gameState.level];
-    updateGameLevel(window, renderState, gameLevel);
-  }
-};
+  gameState.level = (gameState.level + 1) % levelSequence.count;
+  gameState.gameLevel = enterSequenceLevel(levelSequence, gameState.level);
+  printGameLevelMemory(gameState);
+}
 
-void updateRenderState(GLFWwindow* window, RenderState& state)
+// the time the main thread spends simulating and submitting a frame, swapping buffers is left out
+void printFrameStats(FrameStats& stats, GameSettings& settings)
+{
+  std::cout << "FRAME:: particles: " << (settings.particleBackend == PARTICLE_BACKEND_GPU ? "gpu" : "cpu")
+            << " x " << settings.particleCount
+            << ", frames: " << stats.frames
+            << ", cpu ms/frame: " << stats.cpuSeconds * 1000.0 / std::max(1ul, stats.frames)
+            << " (sim " << stats.simulationSeconds * 1000.0 / std::max(1ul, stats.frames)
+            << ", render " << stats.renderSeconds * 1000.0 / std::max(1ul, stats.frames) << ")"
+            << ", steps/frame: " << stats.steps / (double)std::max(1ul, stats.frames)
+            << ", gpu ms/frame: " << stats.gpuSeconds * 1000.0 / std::max(1ul, stats.gpuFrames) << std::endl;
+}
+
+// the timer query of the previous frame is read only once the gpu has finished it, frames whose result is not
+// ready yet are left out rather than stalling on them
+void readGpuFrameTime(FrameStats& stats, unsigned int query)
 {
-  state.time = glfwGetTime();
-  state.deltaTime = state.time - state.lastFrame;
-  state.lastFrame = state.time;
-  glfwGetFramebufferSize(window, &state.bufferWidth, &state.bufferHeight);
-  if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+  int available = 0;
+  glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available)
   {
-    glfwSetWindowShouldClose(window, GL_TRUE);
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+    stats.gpuSeconds += nanoseconds * 1e-9;
+    stats.gpuFrames++;
   }
 }
 
@@ -1398,8 +1156,9 @@ void handleFrameBufferUpdate(GLFWwindow* window, int width, int height)
   glViewport(0, 0, width, height);
 }
 
-int main()
+int main(int argc, char** argv)
 {
+  GameSettings gameSettings = readGameSettings(argc, argv);
   std::tuple<int, int> glVersion = {3, 3};
   WindowSettings windowSettings =
   {
@@ -1408,6 +1167,15 @@ int main()
     .title = {WINDOW_TITLE}
   };
   std::filesystem::path staticFilePath = {STATIC_FILE_PATH};
+  std::optional<Replay> replay = {};
+  if (!gameSettings.replayPath.empty())
+  {
+    replay = loadReplayFile(gameSettings.replayPath);
+    if (!replay.has_value())
+    {
+      return EXIT_FAILURE;
+    }
+  }
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, std::get<0>(glVersion));
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, std::get<1>(glVersion));
@@ -1421,6 +1189,7 @@ int main()
     return EXIT_FAILURE;
   }
   glfwMakeContextCurrent(window);
+  glfwSwapInterval(gameSettings.vsync ? 1 : 0);
   int version = gladLoadGL(glfwGetProcAddress);
   if(version == -1)
   {
@@ -1434,206 +1203,239 @@ int main()
     loadShader(staticFilePath / "sprite.frag", GL_FRAGMENT_SHADER)
   };
   unsigned int spriteShaderProgram = createShaderProgram(spriteShaders);
+  SpriteBatch spriteBatch = createSpriteBatch(spriteShaderProgram);
   std::vector<unsigned int> particleShaders =
   {
     loadShader(staticFilePath / "particle.vert", GL_VERTEX_SHADER),
     loadShader(staticFilePath / "particle.frag", GL_FRAGMENT_SHADER)
   };
   unsigned int particleShaderProgram = createShaderProgram(particleShaders);
-  std::vector<unsigned int> postProcessorShaders =
+  std::vector<unsigned int> particleUpdateShaders =
   {
-    loadShader(staticFilePath / "post_processor.vert", GL_VERTEX_SHADER),
-    loadShader(staticFilePath / "post_processor.frag", GL_FRAGMENT_SHADER)
+    loadShader(staticFilePath / "particle_update.vert", GL_VERTEX_SHADER)
+  };
+  unsigned int particleUpdateShaderProgram = createShaderProgram(particleUpdateShaders, { "outPosition", "outVelocity", "outColor", "outLife" });
+  std::vector<std::filesystem::path> spritePaths =
+  {
+    staticFilePath / "resources/awesomeface.png",
+    staticFilePath / "resources/block.png",
+    staticFilePath / "resources/block_solid.png",
+    staticFilePath / "resources/background.jpg",
+    staticFilePath / "resources/paddle.png",
+    staticFilePath / "resources/powerup_chaos.png",
+    staticFilePath / "resources/powerup_confuse.png",
+    staticFilePath / "resources/powerup_increase.png",
+    staticFilePath / "resources/powerup_passthrough.png",
+    staticFilePath / "resources/powerup_speed.png",
+    staticFilePath / "resources/powerup_sticky.png",
+    staticFilePath / "resources/particle.png",
   };
-  unsigned int postProcessorShaderProgram = createShaderProgram(postProcessorShaders);
-  Sprite awesomeFaceSprite = createSprite(loadTexture(staticFilePath / "resources/awesomeface.png", false));
-  Sprite blockSolidSprite = createSprite(loadTexture(staticFilePath / "resources/block.png", false));
-  Sprite blockDestroyableSprite = createSprite(loadTexture(staticFilePath / "resources/block_solid.png", false));
-  Sprite backgroundSprite = createSprite(loadTexture(staticFilePath / "resources/background.jpg", false));
-  Sprite paddleSprite = createSprite(loadTexture(staticFilePath / "resources/paddle.png", false));
-  Sprite powerUpChaos = createSprite(loadTexture(staticFilePath / "resources/powerup_chaos.png", false));
-  Sprite powerUpConfusion = createSprite(loadTexture(staticFilePath / "resources/powerup_confuse.png", false));
-  Sprite powerUpPaddleSizeUp = createSprite(loadTexture(staticFilePath / "resources/powerup_increase.png", false));
-  Sprite powerUpPassThrough = createSprite(loadTexture(staticFilePath / "resources/powerup_passthrough.png", false));
-  Sprite powerUpSpeed = createSprite(loadTexture(staticFilePath / "resources/powerup_speed.png", false));
-  Sprite powerUpSticky = createSprite(loadTexture(staticFilePath / "resources/powerup_sticky.png", false));
-  Particle ballParticle = createParticle(loadTexture(staticFilePath / "resources/particle.png", false));
+  TextureAtlasImage atlasImage = loadTextureAtlasImage(spritePaths, staticFilePath / "resources/atlas.cache");
+  TextureAtlas atlas = createTextureAtlas(atlasImage);
+  // levels hold handles into the registry, every sprite, shader and the particle model exist once however many levels
+  // there are
+  ResourceRegistry resources = createResourceRegistry();
+  addResource(resources.textures, "atlas", atlas.texture.id);
+  ShaderHandle spriteShader = addResource(resources.shaders, "sprite", spriteShaderProgram);
+  addResource(resources.shaders, "particle_update", particleUpdateShaderProgram);
+  ShaderHandle particleShader = addResource(resources.shaders, "particle", particleShaderProgram);
+  SpriteHandle awesomeFaceSprite = addResource(resources.sprites, "awesomeface", findAtlasSprite(atlas, "awesomeface"));
+  SpriteHandle blockSolidSprite = addResource(resources.sprites, "block", findAtlasSprite(atlas, "block"));
+  SpriteHandle blockDestroyableSprite = addResource(resources.sprites, "block_solid", findAtlasSprite(atlas, "block_solid"));
+  SpriteHandle backgroundSprite = addResource(resources.sprites, "background", findAtlasSprite(atlas, "background"));
+  SpriteHandle paddleSprite = addResource(resources.sprites, "paddle", findAtlasSprite(atlas, "paddle"));
+  SpriteHandle powerUpChaos = addResource(resources.sprites, "powerup_chaos", findAtlasSprite(atlas, "powerup_chaos"));
+  SpriteHandle powerUpConfusion = addResource(resources.sprites, "powerup_confuse", findAtlasSprite(atlas, "powerup_confuse"));
+  SpriteHandle powerUpPaddleSizeUp = addResource(resources.sprites, "powerup_increase", findAtlasSprite(atlas, "powerup_increase"));
+  SpriteHandle powerUpPassThrough = addResource(resources.sprites, "powerup_passthrough", findAtlasSprite(atlas, "powerup_passthrough"));
+  SpriteHandle powerUpSpeed = addResource(resources.sprites, "powerup_speed", findAtlasSprite(atlas, "powerup_speed"));
+  SpriteHandle powerUpSticky = addResource(resources.sprites, "powerup_sticky", findAtlasSprite(atlas, "powerup_sticky"));
+  ParticleHandle ballParticle = addResource(resources.particles, "ball", createParticle(findAtlasSprite(atlas, "particle"), gameSettings.particleCount));
   RenderState renderState =
   {
     .bufferWidth = 0,
     .bufferHeight = 0,
+    .interpolation = 1.0f,
+    .timestep = 0.0f,
   };
   updateRenderState(window, renderState);
-  PlayerConfig playerConfig =
-  {
-    .velocity = 500.0f,
-    .size = glm::vec2(100.0f, 20.0f),
-    .color = glm::vec3(1.0f),
-    .sprite = paddleSprite
+  // every level renders into the same off-screen target, levels themselves own no GL resources
+  PostProcessor postProcessor = createPostProcessor(renderState, staticFilePath);
+  std::unordered_map<PowerUpType, SpriteHandle> powerUpSprites =
+  {
+    { POWER_UP_SPEED, powerUpSpeed },
+    { POWER_UP_STICKY, powerUpSticky },
+    { POWER_UP_PASS_THROUGH, powerUpPassThrough },
+    { POWER_UP_PADDLE_SIZE_UP, powerUpPaddleSizeUp },
+    { POWER_UP_CONFUSION, powerUpConfusion },
+    { POWER_UP_CHAOS, powerUpChaos },
   };
-  BallConfig ballConfig =
+  std::vector<std::filesystem::path> levelPaths =
   {
-    .speed = 400.0f,
-    .radius = 12.5f,
-    .color = glm::vec3(1.0f),
-    .sprite = awesomeFaceSprite,
-    .particleCount = 500,
-    .particleModel = ballParticle
+    staticFilePath / "resources/levels/1.level",
+    staticFilePath / "resources/levels/2.level",
+    staticFilePath / "resources/levels/3.level",
+    staticFilePath / "resources/levels/4.level",
   };
-  ShakeEffectConfig shakeEffectConfig =
+  unsigned int level = 0;
+  for (unsigned int i = 0; i < levelPaths.size() && replay.has_value(); i++)
   {
-    .duration = 0.05f,
-  };
-  std::vector<PowerUpConfig> powerUpConfigs =
+    level = levelPaths[i].filename() == replay.value().header.level ? i : level;
+  }
+  // only paths and handles are captured, a level's tiles are mapped when its config is built
+  LevelConfigSource configSource = [&, powerUpSprites](unsigned int i) mutable
   {
-    PowerUpConfig
-    {
-      .type = POWER_UP_SPEED,
-      .ttl = 10.0f,
-      .chance = 2,
-      .sprite = powerUpSpeed,
-      .velocity = glm::vec2(0.0f, 120.0f),
-      .size = glm::vec2(20.f),
-      .color = glm::vec3(1.0f),
-    },
-    PowerUpConfig
-    {
-      .type = POWER_UP_STICKY,
-      .ttl = 10.0f,
-      .chance = 2,
-      .sprite = powerUpSticky,
-      .velocity = glm::vec2(0.0f, 60.0f),
-      .size = glm::vec2(20.f),
-      .color = glm::vec3(1.0f),
-    },
-    PowerUpConfig
+    GameLevelConfig gameLevelConfig = createGameLevelConfig(
+      loadTileMap(levelPaths[i]),
+      (unsigned int)windowSettings.width,
+      (unsigned int)windowSettings.height
+    );
+    gameLevelConfig.seed = gameSettings.seed + i;
+    // the replayed level is set up exactly as it was recorded
+    if (replay.has_value() && levelPaths[i].filename() == replay.value().header.level)
     {
-      .type = POWER_UP_PASS_THROUGH,
-      .ttl = 10.0f,
-      .chance = 2,
-      .sprite = powerUpPassThrough,
-      .velocity = glm::vec2(0.0f, 200.0f),
-      .size = glm::vec2(20.f),
-      .color = glm::vec3(1.0f),
-    },
-    PowerUpConfig
+      gameLevelConfig = createReplayGameLevelConfig(replay.value(), gameLevelConfig.tileMap);
+    }
+    if (gameSettings.balls > 0)
     {
-      .type = POWER_UP_PADDLE_SIZE_UP,
-      .ttl = 10.0f,
-      .chance = 2,
-      .sprite = powerUpPaddleSizeUp,
-      .velocity = glm::vec2(0.0f, 140.0f),
-      .size = glm::vec2(20.f),
-      .color = glm::vec3(1.0f),
-    },
-    PowerUpConfig
+      gameLevelConfig = createStressGameLevelConfig(gameLevelConfig, gameSettings.balls, gameSettings.particleCount);
+    }
+    else
     {
-      .type = POWER_UP_CHAOS,
-      .ttl = 5.0f,
-      .chance = 8,
-      .sprite = powerUpChaos,
-      .velocity = glm::vec2(0.0f, 50.0f),
-      .size = glm::vec2(20.f),
-      .color = glm::vec3(1.0f),
-    },
-    PowerUpConfig
+      gameLevelConfig.ballConfig.particleCount = gameSettings.particleCount;
+    }
+    gameLevelConfig.playerConfig.sprite = paddleSprite;
+    gameLevelConfig.ballConfig.sprite = awesomeFaceSprite;
+    gameLevelConfig.ballConfig.particleBackend = gameSettings.particleBackend;
+    gameLevelConfig.ballConfig.particleModel = ballParticle;
+    for (PowerUpConfig& powerUpConfig : gameLevelConfig.powerUpConfigs)
     {
-      .type = POWER_UP_CONFUSION,
-      .ttl = 5.0f,
-      .chance = 8,
-      .sprite = powerUpConfusion,
-      .velocity = glm::vec2(0.0f, 100.0f),
-      .size = glm::vec2(20.f),
-      .color = glm::vec3(1.0f),
-    },
+      powerUpConfig.sprite = powerUpSprites[powerUpConfig.type];
+    }
+    gameLevelConfig.background = backgroundSprite;
+    gameLevelConfig.blockSolid = blockSolidSprite;
+    gameLevelConfig.blockDestroyable = blockDestroyableSprite;
+    gameLevelConfig.spriteShader = spriteShader;
+    gameLevelConfig.particleShader = particleShader;
+    return gameLevelConfig;
   };
-  std::vector<GameLevelConfig> gameLevelConfigs =
+  LevelSequence levelSequence = createLevelSequence(levelPaths.size(), configSource);
+  GameState gameState =
   {
-    GameLevelConfig
-    {
-      .tileMap = createTileMap(loadTileData(staticFilePath / "resources/levels/1.txt")),
-      .width = (unsigned int)windowSettings.width,
-      .height = (unsigned int)windowSettings.height,
-      .background = backgroundSprite,
-      .blockSolid = blockSolidSprite,
-      .blockDestroyable = blockDestroyableSprite,
-      .playerConfig = playerConfig,
-      .ballConfig = ballConfig,
-      .shakeEffectConfig = shakeEffectConfig,
-      .powerUpConfigs = powerUpConfigs,
-      .spriteShader = spriteShaderProgram,
-      .particleShader = particleShaderProgram,
-      .postProcessorShader = postProcessorShaderProgram
-    },
-    GameLevelConfig
-    {
-      .tileMap = createTileMap(loadTileData(staticFilePath / "resources/levels/2.txt")),
-      .width = (unsigned int)windowSettings.width,
-      .height = (unsigned int)windowSettings.height,
-      .background = backgroundSprite,
-      .blockSolid = blockSolidSprite,
-      .blockDestroyable = blockDestroyableSprite,
-      .playerConfig = playerConfig,
-      .ballConfig = ballConfig,
-      .shakeEffectConfig = shakeEffectConfig,
-      .powerUpConfigs = powerUpConfigs,
-      .spriteShader = spriteShaderProgram,
-      .particleShader = particleShaderProgram,
-      .postProcessorShader = postProcessorShaderProgram
-    },
-    GameLevelConfig
-    {
-      .tileMap = createTileMap(loadTileData(staticFilePath / "resources/levels/3.txt")),
-      .width = (unsigned int)windowSettings.width,
-      .height = (unsigned int)windowSettings.height,
-      .background = backgroundSprite,
-      .blockSolid = blockSolidSprite,
-      .blockDestroyable = blockDestroyableSprite,
-      .playerConfig = playerConfig,
-      .ballConfig = ballConfig,
-      .shakeEffectConfig = shakeEffectConfig,
-      .powerUpConfigs = powerUpConfigs,
-      .spriteShader = spriteShaderProgram,
-      .particleShader = particleShaderProgram,
-      .postProcessorShader = postProcessorShaderProgram
-    },
-    GameLevelConfig
-    {
-      .tileMap = createTileMap(loadTileData(staticFilePath / "resources/levels/4.txt")),
-      .width = (unsigned int)windowSettings.width,
-      .height = (unsigned int)windowSettings.height,
-      .background = backgroundSprite,
-      .blockSolid = blockSolidSprite,
-      .blockDestroyable = blockDestroyableSprite,
-      .playerConfig = playerConfig,
-      .ballConfig = ballConfig,
-      .shakeEffectConfig = shakeEffectConfig,
-      .powerUpConfigs = powerUpConfigs,
-      .spriteShader = spriteShaderProgram,
-      .particleShader = particleShaderProgram,
-      .postProcessorShader = postProcessorShaderProgram
-    },
+    .status = GAME_ACTIVE,
+    .level = level,
+    .gameLevel = enterSequenceLevel(levelSequence, level)
   };
-  std::vector<GameLevel> gameLevels = {};
-  for (GameLevelConfig& gameLevelConfig: gameLevelConfigs)
+  printGameLevelMemory(gameState);
+  // the levels share one ring, only the active level's balls feed it
+  GpuParticles gpuParticles = {};
+  if (gameSettings.particleBackend == PARTICLE_BACKEND_GPU)
   {
-    gameLevels.push_back(createGameLevel(renderState, gameLevelConfig));
+    gpuParticles = createGpuParticles(getResource(resources.particles, ballParticle), particleUpdateShaderProgram, gameState.gameLevel.config->ballConfig.particleCount);
   }
-  GameState gameState =
-  {
-    .status = GAME_ACTIVE,
-    .levels = gameLevels,
-    .level = 0
+  Renderer renderer =
+  { .resources = resources,
+    .atlas = atlas,
+    .spriteBatch = spriteBatch,
+    .postProcessor = postProcessor,
+    .gpuParticles = gpuParticles,
+    .staticLayer = createStaticLayer(renderState)
+  };
+  // the level always advances in fixed steps, time a frame does not use up is carried to the next one and the frame is
+  // drawn that far between the last two states
+  Simulation simulation = createSimulation(replay.has_value() ? replay.value().header.timestep : 1.0f / gameSettings.tickRate);
+  renderState.timestep = simulation.timestep;
+  ReplayRecorder recorder = createReplayRecorder(levelPaths[level].filename().string(), *gameState.gameLevel.config, simulation.timestep);
+  InputSource inputSource = [window](unsigned long step, GameLevel& gameLevel)
+  {
+    return readWindowInput(window);
   };
+  if (replay.has_value())
+  {
+    inputSource = createReplayInputSource(replay.value());
+  }
+  else if (!gameSettings.recordPath.empty())
+  {
+    inputSource = createRecordingInputSource(inputSource, recorder);
+  }
+  FrameStats frameStats = {};
+  std::array<unsigned int, 2> timerQueries = {};
+  glGenQueries(timerQueries.size(), timerQueries.data());
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
   glfwSetFramebufferSizeCallback(window, handleFrameBufferUpdate);
+  std::chrono::duration<double> framePeriod = std::chrono::duration<double>(gameSettings.frameRate > 0.0f ? 1.0 / gameSettings.frameRate : 0.0);
+  auto nextFrame = std::chrono::steady_clock::now();
   while(!glfwWindowShouldClose(window))
   {
+    auto frameStart = std::chrono::steady_clock::now();
     updateRenderState(window, renderState);
-    updateGameState(window, renderState, gameState);
-    drawGameState(renderState, gameState);
+    if (gameState.status == GAME_ACTIVE)
+    {
+      unsigned int maxSteps = gameSettings.maxStepsPerFrame;
+      if (replay.has_value())
+      {
+        maxSteps = std::min<unsigned long>(maxSteps, replay.value().header.stepCount - simulation.step);
+      }
+      frameStats.steps += advanceSimulation(simulation, inputSource, gameState.gameLevel, renderState.deltaTime, maxSteps);
+      renderState.interpolation = simulationInterpolation(simulation);
+      if (!replay.has_value() && gameSettings.recordPath.empty() && isGameLevelCompleted(gameState.gameLevel))
+      {
+        advanceGameLevel(gameState, levelSequence);
+      }
+      if (replay.has_value() && simulation.step >= replay.value().header.stepCount)
+      {
+        glfwSetWindowShouldClose(window, GL_TRUE);
+      }
+    }
+    auto renderStart = std::chrono::steady_clock::now();
+    unsigned int timerQuery = timerQueries[frameStats.frames % timerQueries.size()];
+    glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+    drawGameState(renderState, renderer, gameSettings, gameState);
+    glEndQuery(GL_TIME_ELAPSED);
+    auto frameEnd = std::chrono::steady_clock::now();
+    frameStats.cpuSeconds += std::chrono::duration<double>(frameEnd - frameStart).count();
+    frameStats.simulationSeconds += std::chrono::duration<double>(renderStart - frameStart).count();
+    frameStats.renderSeconds += std::chrono::duration<double>(frameEnd - renderStart).count();
+    if (frameStats.frames > 0)
+    {
+      readGpuFrameTime(frameStats, timerQueries[(frameStats.frames - 1) % timerQueries.size()]);
+    }
+    frameStats.frames++;
+    if (gameSettings.frames != 0 && frameStats.frames >= gameSettings.frames)
+    {
+      glfwSetWindowShouldClose(window, GL_TRUE);
+    }
+    // the cap sleeps off what is left of the frame's period, a frame that ran late starts the next period from now
+    if (framePeriod.count() > 0.0)
+    {
+      nextFrame = std::max(nextFrame + std::chrono::duration_cast<std::chrono::steady_clock::duration>(framePeriod), std::chrono::steady_clock::now());
+      std::this_thread::sleep_until(nextFrame);
+    }
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
+  printSpriteBatchStats(renderer.spriteBatch);
+  printPostProcessorStats(renderer.postProcessor);
+  printStaticLayerStats(renderer.staticLayer);
+  printFrameStats(frameStats, gameSettings);
+  printLevelSequenceStats(levelSequence);
+  uint64_t finalHash = hashGameLevel(gameState.gameLevel);
+  if (replay.has_value())
+  {
+    bool finished = simulation.step == replay.value().header.stepCount;
+    bool matches = finished && finalHash == replay.value().header.finalHash;
+    std::cout << "REPLAY:: steps: " << simulation.step << "/" << replay.value().header.stepCount
+              << ", final state: " << (matches ? "matches" : "differs") << std::endl;
+    return matches || !finished ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if (!gameSettings.recordPath.empty())
+  {
+    if (!writeReplayFile(gameSettings.recordPath, recorder, finalHash))
+    {
+      std::cout << "Unable to write replay to path: " << gameSettings.recordPath << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "REPLAY:: recorded " << simulation.step << " steps to " << gameSettings.recordPath << std::endl;
+  }
   return EXIT_SUCCESS;
 };
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// read only view of a whole file, the mapping is released together with the last reference to it
+struct MappedFile
+{
+  const uint8_t* data;
+  size_t size;
+};
+
+// returns nothing when the file can not be opened or is empty
+std::shared_ptr<const MappedFile> mapFile(std::filesystem::path path)
+{
+#if defined(_WIN32)
+  // no mmap here, the file is read into memory in one go instead
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file || file.tellg() <= 0)
+  {
+    return nullptr;
+  }
+  size_t size = (size_t)file.tellg();
+  uint8_t* data = new uint8_t[size];
+  file.seekg(0);
+  file.read((char*)data, size);
+  return std::shared_ptr<const MappedFile>(new MappedFile { .data = data, .size = size }, [](const MappedFile* mappedFile)
+  {
+    delete[] mappedFile->data;
+    delete mappedFile;
+  });
+#else
+  int descriptor = open(path.c_str(), O_RDONLY);
+  if (descriptor < 0)
+  {
+    return nullptr;
+  }
+  struct stat status;
+  if (fstat(descriptor, &status) != 0 || status.st_size <= 0)
+  {
+    close(descriptor);
+    return nullptr;
+  }
+  size_t size = (size_t)status.st_size;
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  // the mapping keeps the file alive on its own
+  close(descriptor);
+  if (data == MAP_FAILED)
+  {
+    return nullptr;
+  }
+  return std::shared_ptr<const MappedFile>(new MappedFile { .data = (const uint8_t*)data, .size = size }, [](const MappedFile* mappedFile)
+  {
+    munmap((void*)mappedFile->data, mappedFile->size);
+    delete mappedFile;
+  });
+#endif
+}
@@ -7,10 +7,11 @@ layout (location = 3) in vec4 aColor;
 out vec2 TexCoords;
 out vec4 ParticleColor;
 uniform mat4 projection;
+uniform vec4 textureRect; // <vec2 offset, vec2 size> of the particle in the atlas
 
 void main() {
   float scale = 10.0f;
-  TexCoords = aTextureCoordinate;
+  TexCoords = textureRect.xy + aTextureCoordinate * textureRect.zw;
   ParticleColor = aColor;
   gl_Position = projection * vec4((aPosition * scale) + aOffset, 0.0, 1.0);
 }
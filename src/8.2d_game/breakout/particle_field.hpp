@@ -0,0 +1,188 @@
+#pragma once
+
+#include <vector>
+#include <bit>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+#if defined(__x86_64__) || defined(__i386__)
+#define PARTICLE_FIELD_X86
+#include <immintrin.h>
+#endif
+
+const unsigned int PARTICLE_FIELD_LANES = 8;
+
+// particles as structure of arrays so the integration kernel updates 8 at a time; the first count particles are alive,
+// spawning takes the first free slot and a particle that dies is replaced by the last live one, so both are O(1) and the
+// live particles stay packed for upload. every array keeps PARTICLE_FIELD_LANES free slots past the capacity so the
+// kernel may run over a partly filled last chunk
+struct ParticleField
+{
+  unsigned int count;
+  unsigned int capacity;
+  std::vector<float> positionX;
+  std::vector<float> positionY;
+  std::vector<float> velocityX;
+  std::vector<float> velocityY;
+  std::vector<float> red;
+  std::vector<float> green;
+  std::vector<float> blue;
+  std::vector<float> alpha;
+  std::vector<float> life;
+};
+
+// returns the lanes whose particle died during the step as a bit mask
+using ParticleKernel = unsigned int (*)(ParticleField& field, unsigned int first, float deltaTime, float fade);
+
+ParticleField createParticleField(unsigned int capacity)
+{
+  unsigned int size = capacity + PARTICLE_FIELD_LANES;
+  return ParticleField
+  { .count = 0,
+    .capacity = capacity,
+    .positionX = std::vector<float>(size, 0.0f),
+    .positionY = std::vector<float>(size, 0.0f),
+    .velocityX = std::vector<float>(size, 0.0f),
+    .velocityY = std::vector<float>(size, 0.0f),
+    .red = std::vector<float>(size, 0.0f),
+    .green = std::vector<float>(size, 0.0f),
+    .blue = std::vector<float>(size, 0.0f),
+    .alpha = std::vector<float>(size, 0.0f),
+    .life = std::vector<float>(size, 0.0f)
+  };
+}
+
+// returns false when every particle is alive
+bool spawnParticle(ParticleField& field, glm::vec2 position, glm::vec2 velocity, glm::vec4 color, float life)
+{
+  if (field.count == field.capacity)
+  {
+    return false;
+  }
+  unsigned int i = field.count++;
+  field.positionX[i] = position.x;
+  field.positionY[i] = position.y;
+  field.velocityX[i] = velocity.x;
+  field.velocityY[i] = velocity.y;
+  field.red[i] = color.r;
+  field.green[i] = color.g;
+  field.blue[i] = color.b;
+  field.alpha[i] = color.a;
+  field.life[i] = life;
+  return true;
+}
+
+void killParticle(ParticleField& field, unsigned int index)
+{
+  unsigned int last = --field.count;
+  field.positionX[index] = field.positionX[last];
+  field.positionY[index] = field.positionY[last];
+  field.velocityX[index] = field.velocityX[last];
+  field.velocityY[index] = field.velocityY[last];
+  field.red[index] = field.red[last];
+  field.green[index] = field.green[last];
+  field.blue[index] = field.blue[last];
+  field.alpha[index] = field.alpha[last];
+  field.life[index] = field.life[last];
+}
+
+// the kernels take the same steps in the same order so all of them produce identical particles: life runs down, and a
+// particle still alive afterwards moves against its velocity and fades. a dead lane gets a zero time step instead of a
+// branch, which leaves it where it was
+unsigned int integrateParticlesScalar(ParticleField& field, unsigned int first, float deltaTime, float fade)
+{
+  unsigned int dead = 0;
+  for (unsigned int lane = 0; lane < PARTICLE_FIELD_LANES; lane++)
+  {
+    unsigned int i = first + lane;
+    field.life[i] -= deltaTime;
+    bool alive = field.life[i] > 0.0f;
+    float step = alive ? deltaTime : 0.0f;
+    field.positionX[i] -= field.velocityX[i] * step;
+    field.positionY[i] -= field.velocityY[i] * step;
+    field.alpha[i] -= alive ? fade : 0.0f;
+    dead |= (unsigned int)!alive << lane;
+  }
+  return dead;
+}
+
+#ifdef PARTICLE_FIELD_X86
+__attribute__((target("sse2")))
+unsigned int integrateParticlesSse(ParticleField& field, unsigned int first, float deltaTime, float fade)
+{
+  __m128 zero = _mm_setzero_ps();
+  __m128 step = _mm_set1_ps(deltaTime);
+  __m128 fadeStep = _mm_set1_ps(fade);
+  unsigned int dead = 0;
+  for (unsigned int lane = 0; lane < PARTICLE_FIELD_LANES; lane += 4)
+  {
+    unsigned int i = first + lane;
+    __m128 life = _mm_sub_ps(_mm_loadu_ps(&field.life[i]), step);
+    __m128 alive = _mm_cmpgt_ps(life, zero);
+    __m128 aliveStep = _mm_and_ps(step, alive);
+    _mm_storeu_ps(&field.life[i], life);
+    _mm_storeu_ps(&field.positionX[i], _mm_sub_ps(_mm_loadu_ps(&field.positionX[i]), _mm_mul_ps(_mm_loadu_ps(&field.velocityX[i]), aliveStep)));
+    _mm_storeu_ps(&field.positionY[i], _mm_sub_ps(_mm_loadu_ps(&field.positionY[i]), _mm_mul_ps(_mm_loadu_ps(&field.velocityY[i]), aliveStep)));
+    _mm_storeu_ps(&field.alpha[i], _mm_sub_ps(_mm_loadu_ps(&field.alpha[i]), _mm_and_ps(fadeStep, alive)));
+    dead |= (unsigned int)(~_mm_movemask_ps(alive) & 0xf) << lane;
+  }
+  return dead;
+}
+
+__attribute__((target("avx2")))
+unsigned int integrateParticlesAvx2(ParticleField& field, unsigned int first, float deltaTime, float fade)
+{
+  __m256 step = _mm256_set1_ps(deltaTime);
+  __m256 life = _mm256_sub_ps(_mm256_loadu_ps(&field.life[first]), step);
+  __m256 alive = _mm256_cmp_ps(life, _mm256_setzero_ps(), _CMP_GT_OQ);
+  __m256 aliveStep = _mm256_and_ps(step, alive);
+  _mm256_storeu_ps(&field.life[first], life);
+  // separate multiply and subtract rather than fma, fused rounding would move particles differently than the other kernels
+  _mm256_storeu_ps(&field.positionX[first], _mm256_sub_ps(_mm256_loadu_ps(&field.positionX[first]), _mm256_mul_ps(_mm256_loadu_ps(&field.velocityX[first]), aliveStep)));
+  _mm256_storeu_ps(&field.positionY[first], _mm256_sub_ps(_mm256_loadu_ps(&field.positionY[first]), _mm256_mul_ps(_mm256_loadu_ps(&field.velocityY[first]), aliveStep)));
+  _mm256_storeu_ps(&field.alpha[first], _mm256_sub_ps(_mm256_loadu_ps(&field.alpha[first]), _mm256_and_ps(_mm256_set1_ps(fade), alive)));
+  return (unsigned int)~_mm256_movemask_ps(alive) & 0xff;
+}
+#endif
+
+ParticleKernel selectParticleKernel()
+{
+#ifdef PARTICLE_FIELD_X86
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return integrateParticlesAvx2;
+  }
+  return integrateParticlesSse;
+#else
+  return integrateParticlesScalar;
+#endif
+}
+
+ParticleKernel particleKernel()
+{
+  static ParticleKernel kernel = selectParticleKernel();
+  return kernel;
+}
+
+// runs the chunks from the back so every particle a kill moves down has already been integrated and is known to be alive,
+// each live particle is stepped exactly once and the dead ones are compacted away in the same pass
+void updateParticles(ParticleField& field, float deltaTime, float fade, ParticleKernel kernel = particleKernel())
+{
+  if (field.count == 0)
+  {
+    return;
+  }
+  unsigned int lastChunk = (field.count - 1) / PARTICLE_FIELD_LANES * PARTICLE_FIELD_LANES;
+  for (unsigned int chunk = lastChunk + PARTICLE_FIELD_LANES; chunk != 0;)
+  {
+    chunk -= PARTICLE_FIELD_LANES;
+    unsigned int lanes = std::min(PARTICLE_FIELD_LANES, field.count - chunk);
+    unsigned int dead = kernel(field, chunk, deltaTime, fade) & ((1u << lanes) - 1);
+    while (dead != 0)
+    {
+      unsigned int lane = 31 - std::countl_zero(dead);
+      killParticle(field, chunk + lane);
+      dead &= ~(1u << lane);
+    }
+  }
+}
@@ -0,0 +1,45 @@
+#version 330 core
+layout (location = 0) in vec2 aPosition;
+layout (location = 1) in vec2 aVelocity;
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in float aLife;
+
+// captured by transform feedback into the other buffer, nothing is rasterized
+out vec2 outPosition;
+out vec2 outVelocity;
+out vec4 outColor;
+out float outLife;
+
+// three texels per spawned particle: <vec2 position, vec2 velocity>, color, <life, spawn time>; the spawn time is how far
+// into deltaTime the particle was spawned, it is only stepped by the rest
+uniform samplerBuffer spawns;
+uniform int spawnStart;
+uniform int spawnCount;
+uniform int capacity;
+uniform float deltaTime;
+uniform float fadeRate;
+
+void main() {
+  outPosition = aPosition;
+  outVelocity = aVelocity;
+  outColor = aColor;
+  outLife = aLife;
+  float step = deltaTime;
+  // the particles spawned this frame overwrite the oldest slots of the ring, starting at spawnStart
+  int spawn = (gl_VertexID - spawnStart + capacity) % capacity;
+  if (spawn < spawnCount) {
+    vec4 motion = texelFetch(spawns, spawn * 3);
+    vec4 lifetime = texelFetch(spawns, spawn * 3 + 2);
+    outPosition = motion.xy;
+    outVelocity = motion.zw;
+    outColor = texelFetch(spawns, spawn * 3 + 1);
+    outLife = lifetime.x;
+    step -= lifetime.y;
+  }
+  // same steps as the cpu kernels, a dead particle stays put and turns fully transparent
+  outLife -= step;
+  float alive = float(outLife > 0.0);
+  outPosition -= outVelocity * (step * alive);
+  outColor.a -= step * fadeRate * alive;
+  outColor *= alive;
+}
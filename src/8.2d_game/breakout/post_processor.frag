@@ -3,45 +3,33 @@ in vec2 TexCoords;
 out vec4 color;
 
 uniform sampler2D scene;
-uniform vec2 offsets[9];
-uniform int edgeKernel[9];
-uniform float blurKernel[9];
 
-uniform bool chaos;
-uniform bool confuse;
-uniform bool shake;
+#if defined(CHAOS)
+const float offset = 1.0 / 300.0;
+const vec2 offsets[9] = vec2[](
+    vec2(-offset,  offset), vec2(0.0,  offset), vec2(offset,  offset),
+    vec2(-offset,  0.0),    vec2(0.0,  0.0),    vec2(offset,  0.0),
+    vec2(-offset, -offset), vec2(0.0, -offset), vec2(offset, -offset)
+);
+const float edgeKernel[9] = float[](
+    -1.0, -1.0, -1.0,
+    -1.0,  8.0, -1.0,
+    -1.0, -1.0, -1.0
+);
+#endif
 
+// chaos wins over confuse, and either of them leaves the shake unblurred; a shake on its own samples a scene the
+// blur passes already filtered, so it is a plain copy here
 void main()
 {
-    // zero out memory since an out variable is initialized with undefined values by default 
-    color = vec4(0.0f);
-
-    vec3 sample[9];
-    // sample from texture offsets if using convolution matrix
-    if(chaos || shake)
-        for(int i = 0; i < 9; i++)
-            sample[i] = vec3(texture(scene, TexCoords.st + offsets[i]));
-
-    // process effects
-    if(chaos)
-    {           
-        for(int i = 0; i < 9; i++)
-            color += vec4(sample[i] * edgeKernel[i], 0.0f);
-        color.a = 1.0f;
-    }
-    else if(confuse)
-    {
-        color = vec4(1.0 - texture(scene, TexCoords).rgb, 1.0);
-    }
-    else if(shake)
-    {
-        for(int i = 0; i < 9; i++)
-            color += vec4(sample[i] * blurKernel[i], 0.0f);
-        color.a = 1.0f;
-    }
-    else
-    {
-        color =  texture(scene, TexCoords);
-    }
+#if defined(CHAOS)
+    vec3 edges = vec3(0.0);
+    for(int i = 0; i < 9; i++)
+        edges += texture(scene, TexCoords + offsets[i]).rgb * edgeKernel[i];
+    color = vec4(edges, 1.0);
+#elif defined(CONFUSE)
+    color = vec4(1.0 - texture(scene, TexCoords).rgb, 1.0);
+#else
+    color = texture(scene, TexCoords);
+#endif
 }
-
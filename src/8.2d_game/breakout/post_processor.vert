@@ -4,34 +4,22 @@ layout (location = 1) in vec2 aTextureCoordinate; // <vec2 position, vec2 texCoo
 
 out vec2 TexCoords;
 
-uniform bool chaos;
-uniform bool confuse;
-uniform bool shake;
+// compiled once per combination of CHAOS, CONFUSE and SHAKE defines, without any it is a plain full-screen pass
 uniform float time;
 
 void main()
 {
     gl_Position = vec4(aPosition, 0.0f, 1.0f); 
-    vec2 texture = aTextureCoordinate;
-    if(chaos)
-    {
-        float strength = 0.3;
-        vec2 pos = vec2(texture.x + sin(time) * strength, texture.y + cos(time) * strength);        
-        TexCoords = pos;
-    }
-    else if(confuse)
-    {
-        TexCoords = vec2(1.0 - texture.x, 1.0 - texture.y);
-    }
-    else
-    {
-        TexCoords = texture;
-    }
-    if (shake)
-    {
-        float strength = 0.01;
-        gl_Position.x += cos(time * 10) * strength;        
-        gl_Position.y += cos(time * 15) * strength;        
-    }
+    TexCoords = aTextureCoordinate;
+#if defined(CHAOS)
+    float strength = 0.3;
+    TexCoords += vec2(sin(time), cos(time)) * strength;
+#elif defined(CONFUSE)
+    TexCoords = vec2(1.0 - TexCoords.x, 1.0 - TexCoords.y);
+#endif
+#if defined(SHAKE)
+    float shakeStrength = 0.01;
+    gl_Position.x += cos(time * 10) * shakeStrength;
+    gl_Position.y += cos(time * 15) * shakeStrength;
+#endif
 }
-
@@ -0,0 +1,15 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 color;
+
+uniform sampler2D scene;
+// one texel step along the blurred axis, the two passes together give the 1-2-1 kernel of the old 3x3 blur
+uniform vec2 direction;
+
+void main()
+{
+    vec3 blurred = texture(scene, TexCoords - direction).rgb * 0.25
+                 + texture(scene, TexCoords).rgb * 0.5
+                 + texture(scene, TexCoords + direction).rgb * 0.25;
+    color = vec4(blurred, 1.0);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+// pcg32: 64 bits of state and a per-stream increment, so streams seeded from the same number but with different
+// stream ids never produce the same sequence; the whole state is plain data, so it is saved and restored with the level
+struct RandomStream
+{
+  uint64_t state;
+  uint64_t increment;
+};
+
+uint32_t nextRandom(RandomStream& stream)
+{
+  uint64_t state = stream.state;
+  stream.state = state * 6364136223846793005ull + stream.increment;
+  uint32_t xorShifted = (uint32_t)(((state >> 18u) ^ state) >> 27u);
+  uint32_t rotation = (uint32_t)(state >> 59u);
+  return (xorShifted >> rotation) | (xorShifted << ((-rotation) & 31u));
+}
+
+RandomStream createRandomStream(uint64_t seed, uint64_t streamId)
+{
+  RandomStream stream = { .state = 0, .increment = (streamId << 1u) | 1u };
+  nextRandom(stream);
+  stream.state += seed;
+  nextRandom(stream);
+  return stream;
+}
+
+// in [0, bound), bound has to be above 0; the slight modulo bias is the same rand() % bound had
+unsigned int nextRandomBelow(RandomStream& stream, unsigned int bound)
+{
+  return nextRandom(stream) % bound;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <filesystem>
+#include "game.hpp"
+#include "mapped_file.hpp"
+
+const char REPLAY_FILE_MAGIC[4] = { 'B', 'K', 'R', 'P' };
+const uint32_t REPLAY_FILE_VERSION = 1;
+const unsigned int REPLAY_FILE_LEVEL_SIZE = 64;
+// a run packs the input bits below this and the number of steps it is held for above it
+const unsigned int REPLAY_RUN_INPUT_BITS = 3;
+const uint32_t REPLAY_RUN_MAX_STEPS = UINT32_MAX >> REPLAY_RUN_INPUT_BITS;
+
+enum ReplayInputBit
+{
+  REPLAY_INPUT_LEFT = 1,
+  REPLAY_INPUT_RIGHT = 2,
+  REPLAY_INPUT_LAUNCH = 4,
+};
+
+// a replay is the header and then runCount runs, everything little endian. held keys change a few times a second at
+// most, so storing each input once with how many steps it lasted keeps an hour of play in a few kilobytes
+struct ReplayFileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t seed;
+  float timestep;
+  uint32_t width;
+  uint32_t height;
+  uint32_t stepCount;
+  uint32_t runCount;
+  uint32_t reserved;
+  uint64_t finalHash; // hashGameLevel after the last step, what a re-simulation has to arrive at
+  char level[REPLAY_FILE_LEVEL_SIZE]; // file name of the level, looked up in the levels directory
+};
+
+struct ReplayRecorder
+{
+  ReplayFileHeader header;
+  std::vector<uint32_t> runs;
+};
+
+// runs point into the mapped file
+struct Replay
+{
+  ReplayFileHeader header;
+  const uint32_t* runs;
+  std::shared_ptr<const MappedFile> storage;
+};
+
+uint32_t encodeReplayInput(GameInput input)
+{
+  return (input.left ? REPLAY_INPUT_LEFT : 0) | (input.right ? REPLAY_INPUT_RIGHT : 0) | (input.launch ? REPLAY_INPUT_LAUNCH : 0);
+}
+
+GameInput decodeReplayInput(uint32_t bits)
+{
+  return GameInput
+  { .left = (bits & REPLAY_INPUT_LEFT) != 0,
+    .right = (bits & REPLAY_INPUT_RIGHT) != 0,
+    .launch = (bits & REPLAY_INPUT_LAUNCH) != 0
+  };
+}
+
+ReplayRecorder createReplayRecorder(std::string level, const GameLevelConfig& gameLevelConfig, float timestep)
+{
+  ReplayRecorder recorder =
+  { .header = ReplayFileHeader
+    { .magic = { REPLAY_FILE_MAGIC[0], REPLAY_FILE_MAGIC[1], REPLAY_FILE_MAGIC[2], REPLAY_FILE_MAGIC[3] },
+      .version = REPLAY_FILE_VERSION,
+      .seed = gameLevelConfig.seed,
+      .timestep = timestep,
+      .width = gameLevelConfig.width,
+      .height = gameLevelConfig.height,
+      .stepCount = 0,
+      .runCount = 0,
+      .reserved = 0,
+      .finalHash = 0,
+      .level = {}
+    },
+    .runs = {}
+  };
+  std::strncpy(recorder.header.level, level.c_str(), REPLAY_FILE_LEVEL_SIZE - 1);
+  return recorder;
+}
+
+// called once per simulation step with the input the step used
+void recordReplayInput(ReplayRecorder& recorder, GameInput input)
+{
+  uint32_t bits = encodeReplayInput(input);
+  uint32_t mask = (1u << REPLAY_RUN_INPUT_BITS) - 1;
+  if (recorder.runs.empty() || (recorder.runs.back() & mask) != bits || (recorder.runs.back() >> REPLAY_RUN_INPUT_BITS) == REPLAY_RUN_MAX_STEPS)
+  {
+    recorder.runs.push_back(bits);
+  }
+  recorder.runs.back() += 1u << REPLAY_RUN_INPUT_BITS;
+  recorder.header.stepCount++;
+}
+
+bool writeReplayFile(std::filesystem::path path, ReplayRecorder& recorder, uint64_t finalHash)
+{
+  ReplayFileHeader header = recorder.header;
+  header.runCount = recorder.runs.size();
+  header.finalHash = finalHash;
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char*)&header, sizeof(ReplayFileHeader));
+  file.write((const char*)recorder.runs.data(), recorder.runs.size() * sizeof(uint32_t));
+  return file.good();
+}
+
+// the runs are used straight from the mapping; a file that is not a valid replay loads as nothing
+std::optional<Replay> loadReplayFile(std::filesystem::path path)
+{
+  std::shared_ptr<const MappedFile> file = mapFile(path);
+  Replay replay = { .header = {}, .runs = nullptr, .storage = file };
+  if (file == nullptr || file->size < sizeof(ReplayFileHeader))
+  {
+    std::cout << "ERROR::REPLAY::FILE_NOT_READ " << path << std::endl;
+    return {};
+  }
+  std::memcpy(&replay.header, file->data, sizeof(ReplayFileHeader));
+  if (std::memcmp(replay.header.magic, REPLAY_FILE_MAGIC, sizeof(REPLAY_FILE_MAGIC)) != 0
+    || replay.header.version != REPLAY_FILE_VERSION
+    || !(replay.header.timestep > 0.0f)
+    || replay.header.level[REPLAY_FILE_LEVEL_SIZE - 1] != '\0'
+    || file->size != sizeof(ReplayFileHeader) + (size_t)replay.header.runCount * sizeof(uint32_t))
+  {
+    std::cout << "ERROR::REPLAY::INVALID_FILE " << path << std::endl;
+    return {};
+  }
+  replay.runs = (const uint32_t*)(file->data + sizeof(ReplayFileHeader));
+  unsigned long steps = 0;
+  for (uint32_t i = 0; i < replay.header.runCount; i++)
+  {
+    steps += replay.runs[i] >> REPLAY_RUN_INPUT_BITS;
+  }
+  if (steps != replay.header.stepCount)
+  {
+    std::cout << "ERROR::REPLAY::INVALID_RUNS " << path << std::endl;
+    return {};
+  }
+  return replay;
+}
+
+// the recorded level settings, the caller supplies the tile map of the level the header names
+GameLevelConfig createReplayGameLevelConfig(Replay& replay, TileMap tileMap)
+{
+  GameLevelConfig gameLevelConfig = createGameLevelConfig(tileMap, replay.header.width, replay.header.height);
+  gameLevelConfig.seed = replay.header.seed;
+  return gameLevelConfig;
+}
+
+// plays the runs back in order, steps have to be asked for one after the other from 0; past the end the input is
+// released
+InputSource createReplayInputSource(Replay replay)
+{
+  unsigned int run = 0;
+  unsigned long runEnd = replay.header.runCount > 0 ? replay.runs[0] >> REPLAY_RUN_INPUT_BITS : 0;
+  return [replay, run, runEnd](unsigned long step, GameLevel& gameLevel) mutable
+  {
+    while (run < replay.header.runCount && step >= runEnd)
+    {
+      run++;
+      runEnd += run < replay.header.runCount ? replay.runs[run] >> REPLAY_RUN_INPUT_BITS : 0;
+    }
+    if (run == replay.header.runCount)
+    {
+      return GameInput { .left = false, .right = false, .launch = false };
+    }
+    return decodeReplayInput(replay.runs[run]);
+  };
+}
+
+// wraps another source and records every input it hands out
+InputSource createRecordingInputSource(InputSource inputSource, ReplayRecorder& recorder)
+{
+  return [inputSource, &recorder](unsigned long step, GameLevel& gameLevel) mutable
+  {
+    GameInput input = inputSource(step, gameLevel);
+    recordReplayInput(recorder, input);
+    return input;
+  };
+}
+
+// steps the level through the whole replay and returns the final hash
+uint64_t simulateReplay(Replay& replay, GameLevel& gameLevel)
+{
+  Simulation simulation = createSimulation(replay.header.timestep);
+  InputSource inputSource = createReplayInputSource(replay);
+  for (uint32_t i = 0; i < replay.header.stepCount; i++)
+  {
+    stepSimulation(simulation, inputSource, gameLevel);
+  }
+  return hashGameLevel(gameLevel);
+}
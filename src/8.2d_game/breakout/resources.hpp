@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+
+// configs refer to sprites, textures, shaders and particle models by these, the resource itself lives once in the
+// registry however many levels use it
+using ResourceHandle = uint16_t;
+using SpriteHandle = ResourceHandle;
+using TextureHandle = ResourceHandle;
+using ShaderHandle = ResourceHandle;
+using ParticleHandle = ResourceHandle;
+
+// handle 0 is the table's default resource, what a handle nothing was assigned to resolves to
+template <typename Resource>
+struct ResourceTable
+{
+  std::vector<std::string> names;
+  std::vector<Resource> resources;
+};
+
+template <typename Resource>
+ResourceTable<Resource> createResourceTable(Resource defaultResource)
+{
+  return ResourceTable<Resource>
+  { .names = { "" },
+    .resources = { defaultResource }
+  };
+}
+
+template <typename Resource>
+std::optional<ResourceHandle> findResource(ResourceTable<Resource>& table, std::string name)
+{
+  for (unsigned int i = 1; i < table.names.size(); i++)
+  {
+    if (table.names[i] == name)
+    {
+      return (ResourceHandle)i;
+    }
+  }
+  return {};
+}
+
+// adding a name already in the table replaces its resource and keeps the handle, so handles given out stay valid
+template <typename Resource>
+ResourceHandle addResource(ResourceTable<Resource>& table, std::string name, Resource resource)
+{
+  std::optional<ResourceHandle> handle = findResource(table, name);
+  if (handle.has_value())
+  {
+    table.resources[handle.value()] = resource;
+    return handle.value();
+  }
+  if (table.resources.size() > UINT16_MAX)
+  {
+    std::cout << "ERROR::RESOURCES::TABLE_FULL " << name << std::endl;
+    return 0;
+  }
+  table.names.push_back(name);
+  table.resources.push_back(resource);
+  return (ResourceHandle)(table.resources.size() - 1);
+}
+
+template <typename Resource>
+Resource& getResource(ResourceTable<Resource>& table, ResourceHandle handle)
+{
+  return table.resources[handle < table.resources.size() ? handle : 0];
+}
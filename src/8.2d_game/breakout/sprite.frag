@@ -1,12 +1,12 @@
 #version 330 core
 in vec2 fTextureCoordinate;
+in vec3 fColor;
 
 out vec4 FragColor;
 
 uniform sampler2D texture1;
-uniform vec3 color;
 
 void main()
 {
-  FragColor = vec4(color, 1.0) * texture(texture1, fTextureCoordinate);
+  FragColor = vec4(fColor, 1.0) * texture(texture1, fTextureCoordinate);
 }
@@ -1,14 +1,24 @@
 #version 330 core
 layout (location = 0) in vec2 aPosition;
 layout (location = 1) in vec2 aTextureCoordinate;
+layout (location = 2) in vec4 aRect; // <vec2 position, vec2 size>
+layout (location = 3) in float aRotation;
+layout (location = 4) in vec3 aColor;
+layout (location = 5) in vec4 aTextureRect; // <vec2 offset, vec2 size> of the sprite in the atlas
 
 out vec2 fTextureCoordinate;
+out vec3 fColor;
 
 uniform mat4 projection;
-uniform mat4 model;
 
 void main()
 {
-  fTextureCoordinate = aTextureCoordinate;
-  gl_Position = projection * model * vec4(aPosition, 0.0, 1.0);
+  vec2 size = aRect.zw;
+  vec2 center = size / 2.0;
+  float angle = radians(aRotation);
+  mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+  vec2 position = rotation * (aPosition * size - center) + center + aRect.xy;
+  fTextureCoordinate = aTextureRect.xy + aTextureCoordinate * aTextureRect.zw;
+  fColor = aColor;
+  gl_Position = projection * vec4(position, 0.0, 1.0);
 }
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <tuple>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <stb_image.h>
+#include "mapped_file.hpp"
+
+const char TEXTURE_ATLAS_MAGIC[4] = { 'B', 'K', 'A', 'T' };
+// bumped whenever the packing changes, so caches written by an older packer are rebuilt
+const uint32_t TEXTURE_ATLAS_VERSION = 1;
+const unsigned int TEXTURE_ATLAS_WIDTH = 2048;
+// every sprite is surrounded by copies of its edge pixels, wide enough that the first mip levels never sample a neighbour
+const unsigned int TEXTURE_ATLAS_PADDING = 8;
+const unsigned int TEXTURE_ATLAS_MAX_MIP_LEVEL = 3;
+const unsigned int TEXTURE_ATLAS_NAME_SIZE = 32;
+
+// pixel rect of a sprite inside the atlas, without its padding
+struct TextureAtlasRect
+{
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
+// a packed atlas ready for upload: rgba pixels with the top row first, and the sprites in the order they were given in
+struct TextureAtlasImage
+{
+  unsigned int width;
+  unsigned int height;
+  std::vector<std::string> names;
+  std::vector<TextureAtlasRect> rects;
+  const uint8_t* pixels;
+  // owns the pixels, either the packer's buffer or the mapped cache file
+  std::shared_ptr<const void> storage;
+};
+
+// the cache file is the header, spriteCount entries and then width * height rgba pixels, everything little endian
+struct TextureAtlasFileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t width;
+  uint32_t height;
+  uint32_t spriteCount;
+  uint32_t reserved;
+};
+
+struct TextureAtlasFileEntry
+{
+  char name[TEXTURE_ATLAS_NAME_SIZE];
+  TextureAtlasRect rect;
+};
+
+struct TextureAtlasSource
+{
+  std::string name;
+  int width;
+  int height;
+  std::shared_ptr<uint8_t> pixels;
+};
+
+void hashTextureAtlasBytes(uint64_t& hash, const void* data, size_t size)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+}
+
+// fnv-1a over the packer settings and the name, size and modification time of every source, changing any image
+// or the list itself invalidates the cache without decoding anything
+uint64_t textureAtlasKey(std::vector<std::filesystem::path>& paths)
+{
+  uint64_t hash = 14695981039346656037ull;
+  uint32_t settings[3] = { TEXTURE_ATLAS_VERSION, TEXTURE_ATLAS_WIDTH, TEXTURE_ATLAS_PADDING };
+  hashTextureAtlasBytes(hash, settings, sizeof(settings));
+  for (std::filesystem::path& path : paths)
+  {
+    std::string name = path.filename().string();
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    int64_t time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    hashTextureAtlasBytes(hash, name.data(), name.size() + 1);
+    hashTextureAtlasBytes(hash, &size, sizeof(size));
+    hashTextureAtlasBytes(hash, &time, sizeof(time));
+  }
+  return hash;
+}
+
+// every image is expanded to rgba, one that fails to load becomes a single white pixel so the sprite still exists
+TextureAtlasSource loadTextureAtlasSource(std::filesystem::path& path)
+{
+  TextureAtlasSource source = { .name = path.stem().string(), .width = 1, .height = 1 };
+  int channels;
+  uint8_t* data = stbi_load(path.c_str(), &source.width, &source.height, &channels, 4);
+  if (data)
+  {
+    source.pixels = std::shared_ptr<uint8_t>(data, stbi_image_free);
+  }
+  else
+  {
+    std::cout << "Texture failed to load at path: " << path << std::endl;
+    source.width = 1;
+    source.height = 1;
+    source.pixels = std::shared_ptr<uint8_t>(new uint8_t[4] { 255, 255, 255, 255 }, std::default_delete<uint8_t[]>());
+  }
+  return source;
+}
+
+// copies the source into its rect and smears the edge pixels out over the padding around it
+void blitTextureAtlasSource(std::vector<uint8_t>& pixels, unsigned int atlasWidth, TextureAtlasSource& source, TextureAtlasRect rect)
+{
+  int padding = TEXTURE_ATLAS_PADDING;
+  for (int y = -padding; y < source.height + padding; y++)
+  {
+    int sourceY = std::clamp(y, 0, source.height - 1);
+    for (int x = -padding; x < source.width + padding; x++)
+    {
+      int sourceX = std::clamp(x, 0, source.width - 1);
+      size_t target = ((size_t)(rect.y + y) * atlasWidth + rect.x + x) * 4;
+      memcpy(&pixels[target], &source.pixels.get()[((size_t)sourceY * source.width + sourceX) * 4], 4);
+    }
+  }
+}
+
+// shelf packing, tallest sprites first with ties broken by width and then name, so the same images always give
+// the same atlas whatever order they are listed in
+TextureAtlasImage packTextureAtlas(std::vector<std::filesystem::path>& paths)
+{
+  std::vector<TextureAtlasSource> sources = {};
+  unsigned int width = TEXTURE_ATLAS_WIDTH;
+  for (std::filesystem::path& path : paths)
+  {
+    sources.push_back(loadTextureAtlasSource(path));
+    width = std::max(width, sources.back().width + 2 * TEXTURE_ATLAS_PADDING);
+  }
+  std::vector<unsigned int> order(sources.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+  {
+    return std::tie(sources[b].height, sources[b].width, sources[a].name) < std::tie(sources[a].height, sources[a].width, sources[b].name);
+  });
+  std::vector<TextureAtlasRect> rects(sources.size());
+  unsigned int shelfX = 0;
+  unsigned int shelfY = 0;
+  unsigned int shelfHeight = 0;
+  for (unsigned int i : order)
+  {
+    unsigned int paddedWidth = sources[i].width + 2 * TEXTURE_ATLAS_PADDING;
+    unsigned int paddedHeight = sources[i].height + 2 * TEXTURE_ATLAS_PADDING;
+    if (shelfX + paddedWidth > width)
+    {
+      shelfY += shelfHeight;
+      shelfX = 0;
+      shelfHeight = 0;
+    }
+    rects[i] = TextureAtlasRect
+    { .x = shelfX + TEXTURE_ATLAS_PADDING,
+      .y = shelfY + TEXTURE_ATLAS_PADDING,
+      .width = (uint32_t)sources[i].width,
+      .height = (uint32_t)sources[i].height
+    };
+    shelfX += paddedWidth;
+    shelfHeight = std::max(shelfHeight, paddedHeight);
+  }
+  // a multiple of the padding keeps the mip levels the padding covers at whole texel sizes
+  unsigned int height = std::max(1u, (shelfY + shelfHeight + TEXTURE_ATLAS_PADDING - 1) / TEXTURE_ATLAS_PADDING * TEXTURE_ATLAS_PADDING);
+  std::shared_ptr<std::vector<uint8_t>> pixels = std::make_shared<std::vector<uint8_t>>((size_t)width * height * 4, 0);
+  TextureAtlasImage image =
+  { .width = width,
+    .height = height,
+    .names = {},
+    .rects = rects,
+    .pixels = pixels->data(),
+    .storage = pixels
+  };
+  for (unsigned int i = 0; i < sources.size(); i++)
+  {
+    blitTextureAtlasSource(*pixels, width, sources[i], rects[i]);
+    image.names.push_back(sources[i].name);
+  }
+  return image;
+}
+
+bool writeTextureAtlasCache(std::filesystem::path path, TextureAtlasImage& image, uint64_t key)
+{
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    return false;
+  }
+  TextureAtlasFileHeader header =
+  { .magic = { TEXTURE_ATLAS_MAGIC[0], TEXTURE_ATLAS_MAGIC[1], TEXTURE_ATLAS_MAGIC[2], TEXTURE_ATLAS_MAGIC[3] },
+    .version = TEXTURE_ATLAS_VERSION,
+    .key = key,
+    .width = image.width,
+    .height = image.height,
+    .spriteCount = (uint32_t)image.rects.size(),
+    .reserved = 0
+  };
+  file.write((const char*)&header, sizeof(header));
+  for (unsigned int i = 0; i < image.rects.size(); i++)
+  {
+    TextureAtlasFileEntry entry = { .name = {}, .rect = image.rects[i] };
+    image.names[i].copy(entry.name, TEXTURE_ATLAS_NAME_SIZE - 1);
+    file.write((const char*)&entry, sizeof(entry));
+  }
+  file.write((const char*)image.pixels, (size_t)image.width * image.height * 4);
+  return (bool)file;
+}
+
+// returns an empty atlas when there is no cache or it was written for other images, the pixels stay in the mapping
+TextureAtlasImage loadTextureAtlasCache(std::filesystem::path path, uint64_t key)
+{
+  TextureAtlasImage image = {};
+  std::shared_ptr<const MappedFile> file = mapFile(path);
+  if (!file || file->size < sizeof(TextureAtlasFileHeader))
+  {
+    return image;
+  }
+  TextureAtlasFileHeader header;
+  memcpy(&header, file->data, sizeof(header));
+  size_t entriesSize = (size_t)header.spriteCount * sizeof(TextureAtlasFileEntry);
+  if (memcmp(header.magic, TEXTURE_ATLAS_MAGIC, 4) != 0
+    || header.version != TEXTURE_ATLAS_VERSION
+    || header.key != key
+    || file->size != sizeof(header) + entriesSize + (size_t)header.width * header.height * 4)
+  {
+    return image;
+  }
+  image.width = header.width;
+  image.height = header.height;
+  for (unsigned int i = 0; i < header.spriteCount; i++)
+  {
+    TextureAtlasFileEntry entry;
+    memcpy(&entry, file->data + sizeof(header) + i * sizeof(entry), sizeof(entry));
+    image.names.push_back(std::string(entry.name, strnlen(entry.name, TEXTURE_ATLAS_NAME_SIZE)));
+    image.rects.push_back(entry.rect);
+  }
+  image.pixels = file->data + sizeof(header) + entriesSize;
+  image.storage = file;
+  return image;
+}
+
+// packs the images only when the cache is missing or stale, otherwise startup just maps the previous result
+TextureAtlasImage loadTextureAtlasImage(std::vector<std::filesystem::path> paths, std::filesystem::path cachePath)
+{
+  uint64_t key = textureAtlasKey(paths);
+  TextureAtlasImage image = loadTextureAtlasCache(cachePath, key);
+  if (image.width != 0)
+  {
+    return image;
+  }
+  image = packTextureAtlas(paths);
+  if (!writeTextureAtlasCache(cachePath, image, key))
+  {
+    std::cout << "ERROR::TEXTURE_ATLAS::CACHE_NOT_WRITTEN " << cachePath << std::endl;
+  }
+  return image;
+}
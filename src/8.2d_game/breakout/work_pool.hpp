@@ -0,0 +1,78 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+// the jobs a worker has left, the owner takes from the front and thieves take from the back
+struct WorkQueue
+{
+  std::mutex mutex;
+  std::deque<unsigned int> jobs;
+};
+
+std::optional<unsigned int> popWorkQueueFront(WorkQueue& queue)
+{
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.jobs.empty())
+  {
+    return {};
+  }
+  unsigned int job = queue.jobs.front();
+  queue.jobs.pop_front();
+  return job;
+}
+
+std::optional<unsigned int> popWorkQueueBack(WorkQueue& queue)
+{
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.jobs.empty())
+  {
+    return {};
+  }
+  unsigned int job = queue.jobs.back();
+  queue.jobs.pop_back();
+  return job;
+}
+
+// runs job(index) for every index below jobCount and returns once all of them are done. each worker starts with a
+// contiguous share of the indices and, once its own queue is empty, steals from the far end of the others, so a few
+// long jobs do not leave the rest of the threads idle. no job is added after the start, so a worker that finds every
+// queue empty is done
+template <typename Job>
+void runWorkStealing(unsigned int threadCount, unsigned int jobCount, Job job)
+{
+  threadCount = std::max(1u, std::min(threadCount, jobCount));
+  std::vector<WorkQueue> queues(threadCount);
+  for (unsigned int i = 0; i < jobCount; i++)
+  {
+    queues[(unsigned long)i * threadCount / jobCount].jobs.push_back(i);
+  }
+  std::vector<std::thread> workers = {};
+  for (unsigned int worker = 0; worker < threadCount; worker++)
+  {
+    workers.emplace_back([&queues, &job, threadCount, worker]()
+    {
+      while (true)
+      {
+        std::optional<unsigned int> next = popWorkQueueFront(queues[worker]);
+        for (unsigned int i = 1; i < threadCount && !next.has_value(); i++)
+        {
+          next = popWorkQueueBack(queues[(worker + i) % threadCount]);
+        }
+        if (!next.has_value())
+        {
+          return;
+        }
+        job(next.value());
+      }
+    });
+  }
+  for (std::thread& worker : workers)
+  {
+    worker.join();
+  }
+}
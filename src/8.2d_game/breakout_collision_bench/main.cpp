@@ -0,0 +1,319 @@
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "../breakout/game.hpp"
+
+struct BenchmarkResult
+{
+  unsigned int bricks;
+  double gridPathNanoseconds;
+  double gridRandomNanoseconds;
+  double linearNanoseconds;
+};
+
+// where a measured step starts the ball and where it is heading
+struct BallPlacement
+{
+  glm::vec2 position;
+  glm::vec2 velocity;
+};
+
+struct BrickBoxKernelCase
+{
+  std::string name;
+  BrickBoxKernel kernel;
+};
+
+// results are accumulated here so the measured loops cannot be optimized away
+volatile unsigned int benchmarkSink = 0;
+
+// bricks keep a fixed on-screen size, so the level grows with the brick count instead of the bricks shrinking
+GameLevel createBenchmarkLevel(unsigned int brickCount)
+{
+  unsigned int columns = (unsigned int)std::ceil(std::sqrt((double)brickCount));
+  unsigned int rows = (brickCount + columns - 1) / columns;
+  std::vector<std::vector<unsigned int>> tileData(rows, std::vector<unsigned int>(columns, 0));
+  for (unsigned int i = 0; i < brickCount; i++)
+  {
+    // solid bricks are never destroyed, so every iteration sees the same field
+    tileData[i / columns][i % columns] = 1;
+  }
+  GameLevelConfig gameLevelConfig = createGameLevelConfig(createTileMap(tileData), columns * 40, rows * 20 * 2);
+  return createGameLevel(std::make_shared<const GameLevelConfig>(gameLevelConfig));
+}
+
+std::vector<glm::vec2> createBallPositions(GameLevel& gameLevel, unsigned int count)
+{
+  std::vector<glm::vec2> positions = {};
+  glm::vec2 extent = glm::vec2(gameLevel.map.width, gameLevel.map.height / 2.0f) - glm::vec2(gameLevel.balls.radius * 2.0f);
+  for (unsigned int i = 0; i < count; i++)
+  {
+    positions.push_back(glm::vec2(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX) * extent);
+  }
+  return positions;
+}
+
+// every step somewhere else in the level, on a large level nearly every step starts with cache misses on the grid and
+// the brick field, which no played step sees
+std::vector<BallPlacement> createRandomBallPlacements(GameLevel& gameLevel, unsigned int count)
+{
+  std::vector<BallPlacement> placements = {};
+  for (glm::vec2 position : createBallPositions(gameLevel, count))
+  {
+    placements.push_back(BallPlacement { .position = position, .velocity = glm::vec2(400.0f, -400.0f) });
+  }
+  return placements;
+}
+
+// one ball followed step after step as it flies through the bricks and bounces off the edges of the brick area, which
+// is how the game visits the grid
+std::vector<BallPlacement> createPathBallPlacements(GameLevel& gameLevel, unsigned int count, float deltaTime)
+{
+  std::vector<BallPlacement> placements = {};
+  glm::vec2 extent = glm::vec2(gameLevel.map.width, gameLevel.map.height / 2.0f) - glm::vec2(gameLevel.balls.radius * 2.0f);
+  BallPlacement placement = { .position = createBallPositions(gameLevel, 1)[0], .velocity = glm::vec2(400.0f, -400.0f) };
+  for (unsigned int i = 0; i < count; i++)
+  {
+    placements.push_back(placement);
+    placement.position += placement.velocity * deltaTime;
+    for (int axis = 0; axis < 2; axis++)
+    {
+      if (placement.position[axis] < 0.0f || placement.position[axis] > extent[axis])
+      {
+        placement.position[axis] = glm::clamp(placement.position[axis], 0.0f, extent[axis]);
+        placement.velocity[axis] = -placement.velocity[axis];
+      }
+    }
+  }
+  return placements;
+}
+
+unsigned int countLinearBrickCollisions(GameLevel& gameLevel, BallObject& ball)
+{
+  unsigned int hits = 0;
+  AabbCollisionCircle ballCollisionCircle = ballObjectToAabbCollisionCircle(ball);
+  for (GameObject& brick : gameLevel.map.bricks)
+  {
+    if (brick.status == GAME_OBJECT_ALIVE && checkCircleToBoxCollision(ballCollisionCircle, gameObjectToAabbCollisionBox(brick)).has_value())
+    {
+      hits++;
+    }
+  }
+  return hits;
+}
+
+// the normalize and table scan version directionFromTarget replaced, kept as the reference to measure against
+Direction directionFromTargetNormalized(glm::vec2 target)
+{
+  glm::vec2 normalized = glm::normalize(target);
+  std::vector<std::tuple<Direction, glm::vec2>> directionByPositions = {
+    {DIRECTION_UP, glm::vec2(0.0f,  1.0f)}, // up
+    {DIRECTION_RIGHT, glm::vec2(1.0f,  0.0f)}, // right
+    {DIRECTION_DOWN, glm::vec2(0.0f, -1.0f)}, // down
+    {DIRECTION_LEFT, glm::vec2(-1.0f, 0.0f)}  // left
+  };
+  float max = 0.0f;
+  Direction bestMatch = DIRECTION_UP;
+  for (std::tuple<Direction, glm::vec2>& directionByPosition: directionByPositions)
+  {
+    float scale = glm::dot(normalized, std::get<1>(directionByPosition));
+    if (scale > max)
+    {
+        max = scale;
+        bestMatch = std::get<0>(directionByPosition);
+    }
+  }
+  return bestMatch;
+}
+
+const float BENCHMARK_DELTA_TIME = 1.0f / 60.0f;
+
+template <typename Step>
+double measureNanosecondsPerStep(GameLevel& gameLevel, std::vector<BallPlacement>& placements, Step step)
+{
+  float deltaTime = BENCHMARK_DELTA_TIME;
+  unsigned long steps = 0;
+  std::chrono::duration<double> elapsed = std::chrono::duration<double>::zero();
+  BallObject ball = loadBallObject(gameLevel.balls, 0);
+  auto start = std::chrono::steady_clock::now();
+  while (elapsed.count() < 0.25)
+  {
+    for (unsigned int i = 0; i < 64; i++)
+    {
+      BallPlacement& placement = placements[steps % placements.size()];
+      ball.previousPosition = placement.position - placement.velocity * deltaTime;
+      ball.position = placement.position;
+      ball.velocity = placement.velocity;
+      startBallObjectPath(ball);
+      step(ball, deltaTime);
+      steps++;
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+  }
+  return elapsed.count() * 1e9 / steps;
+}
+
+// the grid is measured both along a ball's path and at random positions, the linear scan reads every brick either way
+BenchmarkResult runBenchmark(unsigned int brickCount)
+{
+  GameLevel gameLevel = createBenchmarkLevel(brickCount);
+  std::vector<BallPlacement> pathPlacements = createPathBallPlacements(gameLevel, 1 << 16, BENCHMARK_DELTA_TIME);
+  std::vector<BallPlacement> randomPlacements = createRandomBallPlacements(gameLevel, 4096);
+  auto gridStep = [&](BallObject& ball, float deltaTime)
+  {
+    BallSweep sweep = createBallSweep(glm::length(ball.velocity));
+    sweepBallObjectBricks(gameLevel, ball, 0, deltaTime, sweep);
+    benchmarkSink = benchmarkSink + sweep.count;
+  };
+  double gridPathNanoseconds = measureNanosecondsPerStep(gameLevel, pathPlacements, gridStep);
+  double gridRandomNanoseconds = measureNanosecondsPerStep(gameLevel, randomPlacements, gridStep);
+  double linearNanoseconds = measureNanosecondsPerStep(gameLevel, randomPlacements, [&](BallObject& ball, float deltaTime)
+  {
+    benchmarkSink = benchmarkSink + countLinearBrickCollisions(gameLevel, ball);
+  });
+  return BenchmarkResult
+  { .bricks = brickCount,
+    .gridPathNanoseconds = gridPathNanoseconds,
+    .gridRandomNanoseconds = gridRandomNanoseconds,
+    .linearNanoseconds = linearNanoseconds
+  };
+}
+
+// repeats body until a quarter second has passed and returns the time per item, body returns the items it handled
+template <typename Body>
+double measureNanosecondsPerItem(Body body)
+{
+  unsigned long items = 0;
+  std::chrono::duration<double> elapsed = std::chrono::duration<double>::zero();
+  auto start = std::chrono::steady_clock::now();
+  while (elapsed.count() < 0.25)
+  {
+    items += body();
+    elapsed = std::chrono::steady_clock::now() - start;
+  }
+  return elapsed.count() * 1e9 / items;
+}
+
+void printBenchmarkRow(std::string name, double nanoseconds)
+{
+  std::cout << std::left << std::setw(40) << name << std::right << std::setw(12) << std::fixed << std::setprecision(3) << nanoseconds << " ns" << std::endl;
+}
+
+std::vector<BrickBoxKernelCase> createBrickBoxKernelCases()
+{
+  std::vector<BrickBoxKernelCase> kernelCases = { BrickBoxKernelCase { .name = "Scalar", .kernel = checkCircleToBrickBoxesScalar } };
+#ifdef BRICK_FIELD_X86
+  kernelCases.push_back(BrickBoxKernelCase { .name = "Sse", .kernel = checkCircleToBrickBoxesSse });
+  if (__builtin_cpu_supports("avx2"))
+  {
+    kernelCases.push_back(BrickBoxKernelCase { .name = "Avx2", .kernel = checkCircleToBrickBoxesAvx2 });
+  }
+#endif
+  return kernelCases;
+}
+
+// every kernel scans the whole field for each ball position, the narrow phase cost per brick without any broad phase,
+// a kernel that disagrees with the scalar one on any position fails the run
+bool runBrickBoxKernelBenchmarks(unsigned int brickCount)
+{
+  GameLevel gameLevel = createBenchmarkLevel(brickCount);
+  BrickField& field = gameLevel.map.brickField;
+  std::vector<glm::vec2> positions = createBallPositions(gameLevel, 256);
+  float radius = gameLevel.balls.radius;
+  std::vector<BrickBoxKernelCase> kernelCases = createBrickBoxKernelCases();
+  std::vector<unsigned int> expectedHits = {};
+  for (BrickBoxKernelCase& kernelCase : kernelCases)
+  {
+    std::vector<unsigned int> hits = {};
+    for (glm::vec2 position : positions)
+    {
+      unsigned int count = 0;
+      for (unsigned int first = 0; first < field.count; first += BRICK_FIELD_LANES)
+      {
+        count += std::popcount(kernelCase.kernel(field, first, position.x + radius, position.y + radius, radius));
+      }
+      hits.push_back(count);
+    }
+    if (expectedHits.empty())
+    {
+      expectedHits = hits;
+    }
+    else if (hits != expectedHits)
+    {
+      std::cout << "BM_CircleBrickBoxes/" << kernelCase.name << " disagrees with the scalar kernel" << std::endl;
+      return false;
+    }
+    double nanoseconds = measureNanosecondsPerItem([&]()
+    {
+      unsigned int count = 0;
+      for (glm::vec2 position : positions)
+      {
+        for (unsigned int first = 0; first < field.count; first += BRICK_FIELD_LANES)
+        {
+          count += kernelCase.kernel(field, first, position.x + radius, position.y + radius, radius);
+        }
+      }
+      benchmarkSink = benchmarkSink + count;
+      return (unsigned long)positions.size() * field.count;
+    });
+    printBenchmarkRow("BM_CircleBrickBoxes/" + kernelCase.name + "/" + std::to_string(brickCount), nanoseconds);
+  }
+  return true;
+}
+
+void runDirectionBenchmarks()
+{
+  std::vector<glm::vec2> targets = {};
+  for (unsigned int i = 0; i < 4096; i++)
+  {
+    targets.push_back(glm::vec2(rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f) * 25.0f);
+  }
+  double normalizedNanoseconds = measureNanosecondsPerItem([&]()
+  {
+    unsigned int sum = 0;
+    for (glm::vec2 target : targets)
+    {
+      sum += directionFromTargetNormalized(target);
+    }
+    benchmarkSink = benchmarkSink + sum;
+    return (unsigned long)targets.size();
+  });
+  double branchFreeNanoseconds = measureNanosecondsPerItem([&]()
+  {
+    unsigned int sum = 0;
+    for (glm::vec2 target : targets)
+    {
+      sum += directionFromTarget(target);
+    }
+    benchmarkSink = benchmarkSink + sum;
+    return (unsigned long)targets.size();
+  });
+  printBenchmarkRow("BM_DirectionFromTarget/Normalized", normalizedNanoseconds);
+  printBenchmarkRow("BM_DirectionFromTarget/BranchFree", branchFreeNanoseconds);
+}
+
+int main()
+{
+  std::vector<unsigned int> brickCounts = { 100, 1000, 10000, 100000, 1000000 };
+  std::cout << "bricks\tgrid ns/step (path)\tgrid ns/step (random)\tlinear ns/step" << std::endl;
+  for (unsigned int brickCount : brickCounts)
+  {
+    BenchmarkResult result = runBenchmark(brickCount);
+    std::cout << result.bricks << "\t" << result.gridPathNanoseconds << "\t" << result.gridRandomNanoseconds << "\t"
+              << result.linearNanoseconds << std::endl;
+  }
+  std::cout << std::endl << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(15) << "Time/item" << std::endl;
+  for (unsigned int brickCount : { 1000u, 100000u })
+  {
+    if (!runBrickBoxKernelBenchmarks(brickCount))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  runDirectionBenchmarks();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <filesystem>
+#include "../breakout/game.hpp"
+
+// compiles text levels into the binary .level format the game loads, usage: <input.txt> <output.level>
+int main(int argc, char** argv)
+{
+  if (argc != 3)
+  {
+    std::cout << "Usage: " << argv[0] << " <input.txt> <output.level>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::filesystem::path inputPath = argv[1];
+  std::filesystem::path outputPath = argv[2];
+  if (!std::filesystem::exists(inputPath))
+  {
+    std::cout << "Level not found at path: " << inputPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  TileMap tileMap = createTileMap(loadTileData(inputPath));
+  if (!writeLevelFile(outputPath, tileMap))
+  {
+    std::cout << "Unable to write level to path: " << outputPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  // reading the result back through the game's loader catches a file it would reject
+  TileMap compiledTileMap = loadLevelFile(outputPath);
+  if (compiledTileMap.columns != tileMap.columns || compiledTileMap.rows != tileMap.rows)
+  {
+    return EXIT_FAILURE;
+  }
+  std::cout << inputPath.string() << " -> " << outputPath.string() << ": "
+            << tileMap.columns << "x" << tileMap.rows << " tiles, "
+            << tileMap.palette.size() << " tile kinds, "
+            << tileMap.brickCount << " bricks" << std::endl;
+  return EXIT_SUCCESS;
+}
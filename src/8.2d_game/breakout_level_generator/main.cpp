@@ -0,0 +1,95 @@
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <filesystem>
+#include "../breakout/game.hpp"
+#include "../breakout/level_generator.hpp"
+
+// generates a seeded level of --tiles tiles (or --columns by --rows), reports how long generating it and setting the
+// game level up from it took, and writes it as a .level file when --output is given
+struct GeneratorSettings
+{
+  LevelGeneratorConfig generatorConfig;
+  std::filesystem::path outputPath;
+};
+
+std::optional<GeneratorSettings> readGeneratorSettings(int argc, char** argv)
+{
+  GeneratorSettings settings =
+  {
+    .generatorConfig = createLevelGeneratorConfig(1000000, 1),
+    .outputPath = {}
+  };
+  LevelGeneratorConfig& config = settings.generatorConfig;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    std::string flag = argv[i];
+    std::string value = argv[i + 1];
+    if (flag == "--tiles")
+    {
+      LevelGeneratorConfig sized = createLevelGeneratorConfig(std::stoul(value), config.seed);
+      config.columns = sized.columns;
+      config.rows = sized.rows;
+    }
+    else if (flag == "--columns")
+      config.columns = std::max(1, std::stoi(value));
+    else if (flag == "--rows")
+      config.rows = std::max(1, std::stoi(value));
+    else if (flag == "--seed")
+      config.seed = std::stoull(value);
+    else if (flag == "--fill")
+      config.fill = std::stof(value);
+    else if (flag == "--solid")
+      config.solidRatio = std::stof(value);
+    else if (flag == "--threads")
+      config.threads = std::max(1, std::stoi(value));
+    else if (flag == "--output")
+      settings.outputPath = value;
+    else if (flag == "--pattern")
+    {
+      std::optional<LevelPattern> pattern = parseLevelPattern(value);
+      if (!pattern.has_value())
+      {
+        std::cout << "Unknown pattern: " << value << ", expected noise, rows, checker or pyramid" << std::endl;
+        return {};
+      }
+      config.pattern = pattern.value();
+    }
+    else
+      std::cout << "Unknown flag: " << flag << std::endl;
+  }
+  return settings;
+}
+
+int main(int argc, char** argv)
+{
+  std::optional<GeneratorSettings> settings = readGeneratorSettings(argc, argv);
+  if (!settings.has_value())
+  {
+    return EXIT_FAILURE;
+  }
+  LevelGeneratorConfig& config = settings.value().generatorConfig;
+  auto start = std::chrono::steady_clock::now();
+  TileMap tileMap = generateTileMap(config);
+  auto generated = std::chrono::steady_clock::now();
+  GameLevel gameLevel = createGameLevel(std::make_shared<const GameLevelConfig>(createGameLevelConfig(tileMap, 800, 600)));
+  auto created = std::chrono::steady_clock::now();
+  std::cout << "level: " << tileMap.columns << "x" << tileMap.rows << " tiles, "
+            << tileMap.brickCount << " bricks, seed " << config.seed << std::endl;
+  std::cout << "generate: " << std::chrono::duration<double>(generated - start).count() * 1000.0 << "ms on "
+            << config.threads << " threads" << std::endl;
+  std::cout << "game level: " << std::chrono::duration<double>(created - generated).count() * 1000.0 << "ms for "
+            << gameLevel.map.bricks.size() << " bricks" << std::endl;
+  std::cout << "startup: " << std::chrono::duration<double>(created - start).count() * 1000.0 << "ms" << std::endl;
+  if (!settings.value().outputPath.empty())
+  {
+    if (!writeLevelFile(settings.value().outputPath, tileMap))
+    {
+      std::cout << "Unable to write level to path: " << settings.value().outputPath << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "written to " << settings.value().outputPath.string() << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
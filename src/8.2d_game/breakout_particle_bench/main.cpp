@@ -0,0 +1,207 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "../breakout/particle_field.hpp"
+
+// the array of structures layout and update loop the particle field replaced, kept as the reference to measure against
+struct ParticleObject
+{
+  glm::vec2 position;
+  glm::vec2 velocity;
+  glm::vec4 color;
+  float life;
+};
+
+struct ParticlePool
+{
+  unsigned int count;
+  std::vector<ParticleObject> particles;
+};
+
+struct ParticleKernelCase
+{
+  std::string name;
+  ParticleKernel kernel;
+};
+
+// results are accumulated here so the measured loops cannot be optimized away
+volatile float benchmarkSink = 0.0f;
+
+const float BENCHMARK_DELTA_TIME = 1.0f / 60.0f;
+const float BENCHMARK_FADE = BENCHMARK_DELTA_TIME * 2.5f;
+
+void updateParticlePool(ParticlePool& pool, float deltaTime, float fade)
+{
+  for (unsigned int i = 0; i < pool.count;)
+  {
+    ParticleObject& particle = pool.particles[i];
+    particle.life -= deltaTime;
+    if (particle.life <= 0.0f)
+    {
+      pool.particles[i] = pool.particles[--pool.count];
+      continue;
+    }
+    particle.position -= particle.velocity * deltaTime;
+    particle.color.a -= fade;
+    i++;
+  }
+}
+
+// the same random particles for both layouts, lives are spread over a second so a steady trickle dies every step
+std::vector<ParticleObject> createParticles(unsigned int count)
+{
+  std::vector<ParticleObject> particles = {};
+  for (unsigned int i = 0; i < count; i++)
+  {
+    float color = rand() / (float)RAND_MAX;
+    particles.push_back(ParticleObject
+    { .position = glm::vec2(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX) * 800.0f,
+      .velocity = glm::vec2(rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f) * 100.0f,
+      .color = glm::vec4(color, color, color, 1.0f),
+      .life = rand() / (float)RAND_MAX
+    });
+  }
+  return particles;
+}
+
+ParticleField createBenchmarkField(std::vector<ParticleObject>& particles)
+{
+  ParticleField field = createParticleField(particles.size());
+  for (ParticleObject& particle : particles)
+  {
+    spawnParticle(field, particle.position, particle.velocity, particle.color, particle.life);
+  }
+  return field;
+}
+
+// the dead are replaced after every step so the measured loop keeps running over a full set of particles
+void refillParticleField(ParticleField& field)
+{
+  while (spawnParticle(field, glm::vec2(400.0f), glm::vec2(10.0f), glm::vec4(1.0f), 1.0f));
+}
+
+void refillParticlePool(ParticlePool& pool)
+{
+  while (pool.count < pool.particles.size())
+  {
+    pool.particles[pool.count++] = ParticleObject
+    { .position = glm::vec2(400.0f),
+      .velocity = glm::vec2(10.0f),
+      .color = glm::vec4(1.0f),
+      .life = 1.0f
+    };
+  }
+}
+
+// repeats body until a quarter second has passed and returns the time per item, body returns the items it handled
+template <typename Body>
+double measureNanosecondsPerItem(Body body)
+{
+  unsigned long items = 0;
+  std::chrono::duration<double> elapsed = std::chrono::duration<double>::zero();
+  auto start = std::chrono::steady_clock::now();
+  while (elapsed.count() < 0.25)
+  {
+    items += body();
+    elapsed = std::chrono::steady_clock::now() - start;
+  }
+  return elapsed.count() * 1e9 / items;
+}
+
+void printBenchmarkRow(std::string name, double nanoseconds)
+{
+  std::cout << std::left << std::setw(40) << name << std::right << std::setw(12) << std::fixed << std::setprecision(3) << nanoseconds << " ns" << std::endl;
+}
+
+std::vector<ParticleKernelCase> createParticleKernelCases()
+{
+  std::vector<ParticleKernelCase> kernelCases = { ParticleKernelCase { .name = "Scalar", .kernel = integrateParticlesScalar } };
+#ifdef PARTICLE_FIELD_X86
+  kernelCases.push_back(ParticleKernelCase { .name = "Sse", .kernel = integrateParticlesSse });
+  if (__builtin_cpu_supports("avx2"))
+  {
+    kernelCases.push_back(ParticleKernelCase { .name = "Avx2", .kernel = integrateParticlesAvx2 });
+  }
+#endif
+  return kernelCases;
+}
+
+bool equalParticleFields(ParticleField& a, ParticleField& b)
+{
+  return a.count == b.count
+    && a.positionX == b.positionX && a.positionY == b.positionY
+    && a.velocityX == b.velocityX && a.velocityY == b.velocityY
+    && a.red == b.red && a.green == b.green && a.blue == b.blue
+    && a.alpha == b.alpha && a.life == b.life;
+}
+
+// every kernel first runs the particles to the end of their lives and has to leave exactly what the scalar kernel
+// leaves, and as many particles as the old loop, a kernel that disagrees fails the run
+bool runParticleBenchmarks(unsigned int particleCount)
+{
+  std::vector<ParticleObject> particles = createParticles(particleCount);
+  ParticlePool pool = ParticlePool { .count = particleCount, .particles = particles };
+  std::vector<unsigned int> expectedCounts = {};
+  for (unsigned int i = 0; i < 30; i++)
+  {
+    updateParticlePool(pool, BENCHMARK_DELTA_TIME, BENCHMARK_FADE);
+    expectedCounts.push_back(pool.count);
+  }
+  double poolNanoseconds = measureNanosecondsPerItem([&]()
+  {
+    refillParticlePool(pool);
+    updateParticlePool(pool, BENCHMARK_DELTA_TIME, BENCHMARK_FADE);
+    benchmarkSink = benchmarkSink + pool.particles[0].position.x;
+    return (unsigned long)pool.particles.size();
+  });
+  printBenchmarkRow("BM_UpdateParticles/Aos/" + std::to_string(particleCount), poolNanoseconds);
+
+  ParticleField expectedField = {};
+  for (ParticleKernelCase& kernelCase : createParticleKernelCases())
+  {
+    ParticleField field = createBenchmarkField(particles);
+    for (unsigned int i = 0; i < 30; i++)
+    {
+      updateParticles(field, BENCHMARK_DELTA_TIME, BENCHMARK_FADE, kernelCase.kernel);
+      if (field.count != expectedCounts[i])
+      {
+        std::cout << "BM_UpdateParticles/" << kernelCase.name << " disagrees with the array of structures loop" << std::endl;
+        return false;
+      }
+    }
+    if (expectedField.count == 0)
+    {
+      expectedField = field;
+    }
+    else if (!equalParticleFields(field, expectedField))
+    {
+      std::cout << "BM_UpdateParticles/" << kernelCase.name << " disagrees with the scalar kernel" << std::endl;
+      return false;
+    }
+    double nanoseconds = measureNanosecondsPerItem([&]()
+    {
+      refillParticleField(field);
+      updateParticles(field, BENCHMARK_DELTA_TIME, BENCHMARK_FADE, kernelCase.kernel);
+      benchmarkSink = benchmarkSink + field.positionX[0];
+      return (unsigned long)field.capacity;
+    });
+    printBenchmarkRow("BM_UpdateParticles/" + kernelCase.name + "/" + std::to_string(particleCount), nanoseconds);
+  }
+  return true;
+}
+
+int main()
+{
+  std::cout << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(15) << "Time/item" << std::endl;
+  for (unsigned int particleCount : { 500u, 10000u, 1000000u, 4000000u })
+  {
+    if (!runParticleBenchmarks(particleCount))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include "../breakout/game.hpp"
+#include "../breakout/replay.hpp"
+#include "../breakout/work_pool.hpp"
+
+// --generate records count autopilot sessions into the directory, --verify re-simulates every replay in it
+struct ReplaySettings
+{
+  std::filesystem::path levelsPath;
+  std::filesystem::path generatePath;
+  std::filesystem::path verifyPath;
+  unsigned int count;
+  float seconds;
+  float timestep;
+  uint64_t seed;
+  unsigned int threads;
+  unsigned int repeat;
+};
+
+struct ReplayResult
+{
+  bool valid;
+  unsigned long steps;
+  uint64_t hash;
+};
+
+ReplaySettings readReplaySettings(int argc, char** argv, std::filesystem::path staticFilePath)
+{
+  ReplaySettings settings =
+  {
+    .levelsPath = staticFilePath / "resources/levels",
+    .generatePath = {},
+    .verifyPath = {},
+    .count = 1000,
+    .seconds = 60.0f,
+    .timestep = 1.0f / 60.0f,
+    .seed = 1,
+    .threads = std::max(1u, std::thread::hardware_concurrency()),
+    .repeat = 1
+  };
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    std::string flag = argv[i];
+    std::string value = argv[i + 1];
+    if (flag == "--levels")
+      settings.levelsPath = value;
+    else if (flag == "--generate")
+      settings.generatePath = value;
+    else if (flag == "--verify")
+      settings.verifyPath = value;
+    else if (flag == "--count")
+      settings.count = std::stoul(value);
+    else if (flag == "--seconds")
+      settings.seconds = std::stof(value);
+    else if (flag == "--timestep")
+      settings.timestep = std::stof(value);
+    else if (flag == "--seed")
+      settings.seed = std::stoull(value);
+    else if (flag == "--threads")
+      settings.threads = std::max(1, std::stoi(value));
+    else if (flag == "--repeat")
+      settings.repeat = std::max(1, std::stoi(value));
+    else
+      std::cout << "Unknown flag: " << flag << std::endl;
+  }
+  return settings;
+}
+
+std::vector<std::filesystem::path> findFiles(std::filesystem::path directory, std::string extension)
+{
+  std::vector<std::filesystem::path> paths = {};
+  for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory))
+  {
+    if (entry.is_regular_file() && entry.path().extension() == extension)
+    {
+      paths.push_back(entry.path());
+    }
+  }
+  // directory order is unspecified, sorting keeps seeds and reports the same between runs
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// the autopilot with a seeded hand on the keys, so sessions on the same level take different paths
+InputSource createJitteredAutopilotInputSource(uint64_t seed)
+{
+  InputSource autopilot = createAutopilotInputSource();
+  RandomStream random = createRandomStream(seed, 0);
+  GameInput held = { .left = false, .right = false, .launch = false };
+  unsigned int heldSteps = 0;
+  return [autopilot, random, held, heldSteps](unsigned long step, GameLevel& gameLevel) mutable
+  {
+    if (heldSteps > 0)
+    {
+      heldSteps--;
+      return held;
+    }
+    if (nextRandomBelow(random, 20) == 0)
+    {
+      bool left = nextRandomBelow(random, 2) == 0;
+      held = GameInput { .left = left, .right = !left, .launch = false };
+      heldSteps = nextRandomBelow(random, 30);
+      return held;
+    }
+    return autopilot(step, gameLevel);
+  };
+}
+
+// levels are loaded once and shared read-only by every job, the tile storage is never written
+std::vector<TileMap> loadLevels(std::vector<std::filesystem::path>& levelPaths)
+{
+  std::vector<TileMap> tileMaps = {};
+  for (std::filesystem::path& levelPath : levelPaths)
+  {
+    tileMaps.push_back(loadTileMap(levelPath));
+  }
+  return tileMaps;
+}
+
+int generateReplays(ReplaySettings& settings)
+{
+  std::vector<std::filesystem::path> levelPaths = findFiles(settings.levelsPath, ".level");
+  if (levelPaths.empty())
+  {
+    std::cout << "No levels found at path: " << settings.levelsPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<TileMap> tileMaps = loadLevels(levelPaths);
+  std::filesystem::create_directories(settings.generatePath);
+  unsigned long steps = (unsigned long)std::lround(settings.seconds / settings.timestep);
+  std::atomic<unsigned int> failures = 0;
+  auto start = std::chrono::steady_clock::now();
+  runWorkStealing(settings.threads, settings.count, [&](unsigned int job)
+  {
+    unsigned int level = job % levelPaths.size();
+    GameLevelConfig gameLevelConfig = createGameLevelConfig(tileMaps[level], 800, 600);
+    gameLevelConfig.seed = settings.seed + job;
+    GameLevel gameLevel = createGameLevel(std::make_shared<const GameLevelConfig>(gameLevelConfig));
+    ReplayRecorder recorder = createReplayRecorder(levelPaths[level].filename().string(), gameLevelConfig, settings.timestep);
+    Simulation simulation = createSimulation(settings.timestep);
+    InputSource inputSource = createRecordingInputSource(createJitteredAutopilotInputSource(gameLevelConfig.seed), recorder);
+    for (unsigned long i = 0; i < steps; i++)
+    {
+      stepSimulation(simulation, inputSource, gameLevel);
+    }
+    std::filesystem::path path = settings.generatePath / ("replay_" + std::to_string(job) + ".replay");
+    if (!writeReplayFile(path, recorder, hashGameLevel(gameLevel)))
+    {
+      std::cout << "Unable to write replay to path: " << path << std::endl;
+      failures++;
+    }
+  });
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "recorded " << settings.count << " replays of " << steps << " steps into " << settings.generatePath
+            << " in " << elapsed.count() << "s" << std::endl;
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// every replay is simulated repeat times from a fresh level, each run has to arrive at the recorded hash
+int verifyReplays(ReplaySettings& settings)
+{
+  std::vector<std::filesystem::path> replayPaths = findFiles(settings.verifyPath, ".replay");
+  std::vector<std::optional<Replay>> replays = {};
+  for (std::filesystem::path& replayPath : replayPaths)
+  {
+    replays.push_back(loadReplayFile(replayPath));
+  }
+  std::vector<std::filesystem::path> levelPaths = {};
+  for (std::optional<Replay>& replay : replays)
+  {
+    std::filesystem::path levelPath = settings.levelsPath / (replay.has_value() ? replay.value().header.level : "");
+    if (replay.has_value() && std::find(levelPaths.begin(), levelPaths.end(), levelPath) == levelPaths.end())
+    {
+      levelPaths.push_back(levelPath);
+    }
+  }
+  std::vector<TileMap> tileMaps = loadLevels(levelPaths);
+  unsigned int jobCount = replays.size() * settings.repeat;
+  std::vector<ReplayResult> results(jobCount, ReplayResult { .valid = false, .steps = 0, .hash = 0 });
+  auto start = std::chrono::steady_clock::now();
+  runWorkStealing(settings.threads, jobCount, [&](unsigned int job)
+  {
+    std::optional<Replay>& replay = replays[job / settings.repeat];
+    if (!replay.has_value())
+    {
+      return;
+    }
+    std::filesystem::path levelPath = settings.levelsPath / replay.value().header.level;
+    unsigned int level = std::find(levelPaths.begin(), levelPaths.end(), levelPath) - levelPaths.begin();
+    GameLevel gameLevel = createGameLevel(std::make_shared<const GameLevelConfig>(createReplayGameLevelConfig(replay.value(), tileMaps[level])));
+    results[job] = ReplayResult
+    { .valid = true,
+      .steps = replay.value().header.stepCount,
+      .hash = simulateReplay(replay.value(), gameLevel)
+    };
+  });
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  unsigned long steps = 0;
+  unsigned int mismatches = 0;
+  for (unsigned int job = 0; job < jobCount; job++)
+  {
+    std::optional<Replay>& replay = replays[job / settings.repeat];
+    steps += results[job].steps;
+    if (!results[job].valid || results[job].hash != replay.value().header.finalHash)
+    {
+      std::cout << "MISMATCH " << replayPaths[job / settings.repeat] << " run " << job % settings.repeat << std::endl;
+      mismatches++;
+    }
+  }
+  std::cout << "replays: " << replays.size() << " x " << settings.repeat << " on " << settings.threads << " threads" << std::endl;
+  std::cout << "steps: " << steps << " in " << elapsed.count() << "s wall clock" << std::endl;
+  std::cout << "replays/sec: " << jobCount / elapsed.count() << ", steps/sec: " << steps / elapsed.count() << std::endl;
+  std::cout << "mismatches: " << mismatches << std::endl;
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv)
+{
+  std::filesystem::path staticFilePath = {STATIC_FILE_PATH};
+  ReplaySettings settings = readReplaySettings(argc, argv, staticFilePath);
+  if (!settings.generatePath.empty())
+  {
+    int status = generateReplays(settings);
+    if (status != EXIT_SUCCESS || settings.verifyPath.empty())
+    {
+      return status;
+    }
+  }
+  if (settings.verifyPath.empty())
+  {
+    std::cout << "Usage: " << argv[0] << " [--generate <dir> --count <n>] [--verify <dir> --repeat <n>] [--threads <n>]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!std::filesystem::is_directory(settings.verifyPath))
+  {
+    std::cout << "Replays not found at path: " << settings.verifyPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  return verifyReplays(settings);
+}
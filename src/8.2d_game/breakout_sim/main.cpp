@@ -0,0 +1,212 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <filesystem>
+#include "../breakout/game.hpp"
+#include "../breakout/level_generator.hpp"
+
+struct SimulationSettings
+{
+  std::filesystem::path levelPath;
+  float seconds;
+  float timestep;
+  unsigned int threads;
+  float compareTimestep;
+  unsigned int balls; // above 0 the stress configuration with this many balls
+  unsigned int particleCount; // size of the trail the balls share
+  unsigned long tiles; // above 0 a generated level of this many tiles replaces the level file
+  uint64_t seed;
+};
+
+struct SimulationReport
+{
+  unsigned long steps;
+  float simulatedSeconds;
+  unsigned int bricksDestroyed;
+  unsigned int particlesAlive;
+};
+
+SimulationSettings readSimulationSettings(int argc, char** argv, std::filesystem::path staticFilePath)
+{
+  SimulationSettings settings =
+  {
+    .levelPath = staticFilePath / "resources/levels/1.level",
+    .seconds = 600.0f,
+    .timestep = 1.0f / 60.0f,
+    .threads = std::max(1u, std::thread::hardware_concurrency()),
+    .compareTimestep = 0.0f,
+    .balls = 0,
+    .particleCount = BALL_PARTICLE_COUNT,
+    .tiles = 0,
+    .seed = 1
+  };
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    std::string flag = argv[i];
+    std::string value = argv[i + 1];
+    if (flag == "--level")
+      settings.levelPath = value;
+    else if (flag == "--seconds")
+      settings.seconds = std::stof(value);
+    else if (flag == "--timestep")
+      settings.timestep = std::stof(value);
+    else if (flag == "--threads")
+      settings.threads = std::max(1, std::stoi(value));
+    else if (flag == "--compare-timestep")
+      settings.compareTimestep = std::stof(value);
+    else if (flag == "--balls")
+      settings.balls = std::stoul(value);
+    else if (flag == "--particle-count")
+      settings.particleCount = std::max(1ul, std::stoul(value));
+    else if (flag == "--tiles")
+      settings.tiles = std::stoul(value);
+    else if (flag == "--seed")
+      settings.seed = std::stoull(value);
+    else
+      std::cout << "Unknown flag: " << flag << std::endl;
+  }
+  return settings;
+}
+
+unsigned int countBricksDestroyed(GameLevel& gameLevel)
+{
+  unsigned int bricksDestroyed = 0;
+  for (GameObject& brick : gameLevel.map.bricks)
+  {
+    if (brick.status == GAME_OBJECT_DESTROYED)
+    {
+      bricksDestroyed++;
+    }
+  }
+  return bricksDestroyed;
+}
+
+// every thread plays its own level, the config behind them is shared
+SimulationReport runSimulation(SimulationSettings& settings, std::shared_ptr<const GameLevelConfig> gameLevelConfig)
+{
+  GameLevel gameLevel = createGameLevel(gameLevelConfig);
+  Simulation simulation = createSimulation(settings.timestep);
+  InputSource inputSource = createAutopilotInputSource();
+  unsigned long steps = (unsigned long)std::lround(settings.seconds / settings.timestep);
+  for (unsigned long i = 0; i < steps; i++)
+  {
+    stepSimulation(simulation, inputSource, gameLevel);
+  }
+  return SimulationReport
+  { .steps = simulation.step,
+    .simulatedSeconds = simulation.time,
+    .bricksDestroyed = countBricksDestroyed(gameLevel),
+    .particlesAlive = gameLevel.trail.particles.count
+  };
+}
+
+// only the ball is independent of the timestep, so the paddle stands still and spans the level so that the ball
+// never drops, and power ups are left out since where they fall and whether they are caught depends on the timestep
+GameLevel runBallOnlySimulation(GameLevelConfig gameLevelConfig, float seconds, float timestep)
+{
+  for (PowerUpConfig& powerUpConfig : gameLevelConfig.powerUpConfigs)
+  {
+    powerUpConfig.chance = 0;
+  }
+  gameLevelConfig.playerConfig.size.x = (float)gameLevelConfig.width;
+  GameLevel gameLevel = createGameLevel(std::make_shared<const GameLevelConfig>(gameLevelConfig));
+  Simulation simulation = createSimulation(timestep);
+  InputSource inputSource = createScriptedInputSource({ GameInput { .left = false, .right = false, .launch = true } });
+  unsigned long steps = (unsigned long)std::lround(seconds / timestep);
+  for (unsigned long i = 0; i < steps; i++)
+  {
+    stepSimulation(simulation, inputSource, gameLevel);
+  }
+  return gameLevel;
+}
+
+bool compareTimesteps(SimulationSettings& settings, GameLevelConfig gameLevelConfig)
+{
+  GameLevel gameLevel = runBallOnlySimulation(gameLevelConfig, settings.seconds, settings.timestep);
+  GameLevel comparedGameLevel = runBallOnlySimulation(gameLevelConfig, settings.seconds, settings.compareTimestep);
+  bool identical = gameLevel.balls.count == comparedGameLevel.balls.count;
+  for (unsigned int i = 0; identical && i < gameLevel.balls.count; i++)
+  {
+    identical = gameLevel.balls.velocity[i] == comparedGameLevel.balls.velocity[i];
+  }
+  for (unsigned int i = 0; i < gameLevel.map.bricks.size(); i++)
+  {
+    identical = identical && gameLevel.map.bricks[i].status == comparedGameLevel.map.bricks[i].status;
+  }
+  std::cout << "level: " << settings.levelPath << std::endl;
+  std::cout << "timestep " << settings.timestep << "s: " << countBricksDestroyed(gameLevel) << " bricks destroyed" << std::endl;
+  std::cout << "timestep " << settings.compareTimestep << "s: " << countBricksDestroyed(comparedGameLevel) << " bricks destroyed" << std::endl;
+  std::cout << "outcome after " << settings.seconds << "s: " << (identical ? "identical" : "different") << std::endl;
+  return identical;
+}
+
+int main(int argc, char** argv)
+{
+  std::filesystem::path staticFilePath = {STATIC_FILE_PATH};
+  SimulationSettings settings = readSimulationSettings(argc, argv, staticFilePath);
+  if (settings.tiles == 0 && !std::filesystem::exists(settings.levelPath))
+  {
+    std::cout << "Level not found at path: " << settings.levelPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  TileMap tileMap = {};
+  if (settings.tiles > 0)
+  {
+    LevelGeneratorConfig generatorConfig = createLevelGeneratorConfig(settings.tiles, settings.seed);
+    tileMap = generateTileMap(generatorConfig);
+    settings.levelPath = "generated " + std::to_string(tileMap.columns) + "x" + std::to_string(tileMap.rows);
+  }
+  else
+  {
+    tileMap = loadTileMap(settings.levelPath);
+  }
+  GameLevelConfig gameLevelConfig = createGameLevelConfig(tileMap, 800, 600);
+  if (settings.balls > 0)
+  {
+    gameLevelConfig = createStressGameLevelConfig(gameLevelConfig, settings.balls, settings.particleCount);
+  }
+  else
+  {
+    gameLevelConfig.ballConfig.particleCount = settings.particleCount;
+  }
+  if (settings.compareTimestep > 0.0f)
+  {
+    return compareTimesteps(settings, gameLevelConfig) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  std::shared_ptr<const GameLevelConfig> sharedConfig = std::make_shared<const GameLevelConfig>(gameLevelConfig);
+  std::vector<SimulationReport> reports(settings.threads);
+  std::vector<std::thread> workers = {};
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < settings.threads; i++)
+  {
+    workers.emplace_back([&settings, &reports, sharedConfig, i]()
+    {
+      reports[i] = runSimulation(settings, sharedConfig);
+    });
+  }
+  for (std::thread& worker : workers)
+  {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  unsigned long steps = 0;
+  double simulatedSeconds = 0.0;
+  for (SimulationReport& report : reports)
+  {
+    steps += report.steps;
+    simulatedSeconds += report.simulatedSeconds;
+  }
+  std::cout << "level: " << settings.levelPath << std::endl;
+  std::cout << "threads: " << settings.threads << ", timestep: " << settings.timestep << "s, balls: " << std::max(1u, settings.balls)
+            << ", trail: " << settings.particleCount << " particles" << std::endl;
+  std::cout << "bricks destroyed (thread 0): " << reports[0].bricksDestroyed << std::endl;
+  std::cout << "particles alive (thread 0): " << reports[0].particlesAlive << std::endl;
+  std::cout << "steps: " << steps << " in " << elapsed.count() << "s wall clock" << std::endl;
+  std::cout << "steps/sec: " << steps / elapsed.count() << ", sim ms/step: " << elapsed.count() * 1000.0 * settings.threads / steps << std::endl;
+  std::cout << "simulated seconds/sec: " << simulatedSeconds / elapsed.count() << std::endl;
+  return EXIT_SUCCESS;
+}